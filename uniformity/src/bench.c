@@ -0,0 +1,270 @@
+/**
+ * @file bench.c
+ * @brief The benchmark driver: times each pipeline stage in isolation
+ * over a directory of OFF files and prints machine-readable CSV.
+ * @remark Built by `make bench`. This includes main.c wholesale (the
+ * engine is a single translation unit) with the real main compiled out,
+ * so every internal stage is callable without exporting anything.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+#define CANIM_BENCH_DRIVER
+#include "main.c"
+
+#include <dirent.h>
+#include <time.h>
+#include <sys/resource.h>
+
+/**
+ * @brief Monotonic wall time in seconds
+ * @return now
+ */
+
+static double bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/**
+ * @brief Peak resident set size so far, in kilobytes
+ * @return the peak rss
+ */
+
+static long bench_peak_rss_kb(void)
+{
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_maxrss;
+}
+
+/**
+ * @brief Prints one CSV row
+ * @param file The off file
+ * @param stage The stage name
+ * @param seconds How long the stage took
+ * @param triangles How many triangles the file produced
+ * @return nothing
+ */
+
+static void bench_row(const char* file, const char* stage, double seconds, int triangles)
+{
+    double tps = seconds > 0 ? triangles / seconds : 0;
+    printf("%s,%s,%.6f,%d,%.1f,%ld\n", file, stage, seconds, triangles, tps, bench_peak_rss_kb());
+}
+
+/**
+ * @brief Runs the whole pipeline over one OFF file, timing each stage
+ * @param[out] result The status
+ * @param path The off file
+ * @return nothing
+ * @remark The per-face loop mirrors triangulate_face but keeps the
+ * stages apart so generate_pslg, split_entirely, dedup_pslg, and the
+ * vertex attacks each get their own accumulated time.
+ */
+
+static void bench_file(CanimResult* result, const char* path)
+{
+    double t0 = bench_now();
+    FILE* fin = fopen(path, "r");
+    if (!fin)
+    {
+        *result = OFF_READ_FILE_ERROR;
+        return;
+    }
+    Polyhedron* poly = read_off_into_polyhedron(result, fin);
+    fclose(fin);
+    if (IS_AN_ERROR(*result))
+    {
+        return;
+    }
+    double t_read = bench_now() - t0;
+
+    Triangulation** tris = malloc(poly->face_count * sizeof(Triangulation*));
+    Vec3* verts = null;
+    int verts_cap = 0;
+    if (!tris)
+    {
+        free_polyhedron(poly);
+        *result = TRIANGULATE_POLYHEDRON_BATCH_TRIANGULATIONS_MALLOC_ERROR;
+        return;
+    }
+    for (int i = 0; i < poly->face_count; i++)
+    {
+        tris[i] = null;
+    }
+    Arena arena = { null };
+    double t_pslg = 0;
+    double t_split = 0;
+    double t_dedup = 0;
+    double t_attack = 0;
+    for (int i = 0; i < poly->face_count; i++)
+    {
+        PolygonIndexed* face = &poly->poly[i];
+        if (face->vertex_count > verts_cap)
+        {
+            free(verts);
+            verts_cap = BIT_ALIGN(face->vertex_count);
+            verts = malloc(verts_cap * sizeof(Vec3));
+            if (!verts)
+            {
+                *result = TRIANGULATE_POLYHEDRON_VERTEX_MALLOC_ERROR;
+                break;
+            }
+        }
+        for (int v = 0; v < face->vertex_count; v++)
+        {
+            verts[v] = poly->vertices[face->vertices[v]];
+        }
+        PolygonRaw pr =
+        {
+            .vertex_count = face->vertex_count,
+            .vertices = verts,
+            .fd = face->fd
+        };
+        double t = bench_now();
+        PSLG* pslg = generate_pslg(result, pr, &arena);
+        t_pslg += bench_now() - t;
+        if (IS_AN_ERROR(*result))
+        {
+            break;
+        }
+        t = bench_now();
+        split_entirely(result, pslg);
+        t_split += bench_now() - t;
+        if (IS_AN_ERROR(*result))
+        {
+            break;
+        }
+        // split_entirely already dedups between rounds, but we still want
+        // a number for the pass itself, so run one more on the final pslg
+        t = bench_now();
+        dedup_pslg(result, pslg);
+        t_dedup += bench_now() - t;
+        if (IS_AN_ERROR(*result))
+        {
+            break;
+        }
+        PSLGTriangulation* pslgtri = create_pslg_triangulation(result, pslg);
+        if (IS_AN_ERROR(*result))
+        {
+            break;
+        }
+        t = bench_now();
+        attack_all_vertices(result, pslgtri);
+        t_attack += bench_now() - t;
+        if (IS_AN_ERROR(*result))
+        {
+            free_triangulation(pslgtri->triangulation);
+            break;
+        }
+        tris[i] = pslgtri->triangulation;
+        arena_reset(&arena);
+    }
+    free(verts);
+    arena_destroy(&arena);
+    if (IS_AN_ERROR(*result))
+    {
+        for (int i = 0; i < poly->face_count; i++)
+        {
+            if (tris[i])
+            {
+                free_triangulation(tris[i]);
+            }
+        }
+        free(tris);
+        free_polyhedron(poly);
+        return;
+    }
+
+    Triangulation merged;
+    double t = bench_now();
+    merge_triangulations(result, tris, poly->face_count, &merged);
+    double t_merge = bench_now() - t;
+    for (int i = 0; i < poly->face_count; i++)
+    {
+        if (tris[i])
+        {
+            free_triangulation(tris[i]);
+        }
+    }
+    free(tris);
+    free_polyhedron(poly);
+    if (IS_AN_ERROR(*result))
+    {
+        return;
+    }
+
+    FILE* sink = tmpfile();
+    if (!sink)
+    {
+        free(merged.triangles);
+        *result = STL_HEADER_WRITE_ERROR;
+        return;
+    }
+    t = bench_now();
+    write_to_stl(result, &merged, sink);
+    double t_stl = bench_now() - t;
+    fclose(sink);
+    int triangles = merged.triangle_count;
+    free(merged.triangles);
+    if (IS_AN_ERROR(*result))
+    {
+        return;
+    }
+
+    bench_row(path, "read_off", t_read, triangles);
+    bench_row(path, "generate_pslg", t_pslg, triangles);
+    bench_row(path, "split_entirely", t_split, triangles);
+    bench_row(path, "dedup_pslg", t_dedup, triangles);
+    bench_row(path, "attack_all_vertices", t_attack, triangles);
+    bench_row(path, "merge_triangulations", t_merge, triangles);
+    bench_row(path, "write_to_stl", t_stl, triangles);
+    *result = SUCCESS;
+}
+
+/**
+ * @brief The bench main: one directory of OFF files in, CSV out
+ * @param argc The argument count
+ * @param argv The arguments
+ * @return 0 on success
+ */
+
+int main(int argc, char* argv[])
+{
+    if (argc != 2)
+    {
+        fprintf(stderr, "usage: %s <directory of .off files>\n", argv[0]);
+        return 1;
+    }
+    DIR* dir = opendir(argv[1]);
+    if (!dir)
+    {
+        fprintf(stderr, "opendir failed: %s\n", strerror(errno));
+        return 1;
+    }
+    printf("file,stage,seconds,triangles,triangles_per_sec,peak_rss_kb\n");
+    int failures = 0;
+    struct dirent* entry;
+    for (;(entry = readdir(dir)) != null;)
+    {
+        size_t len = strlen(entry->d_name);
+        if (len < 4 || strcmp(entry->d_name + len - 4, ".off") != 0)
+        {
+            continue;
+        }
+        char path[BUFFER_SIZE];
+        snprintf(path, sizeof(path), "%s/%s", argv[1], entry->d_name);
+        CanimResult result = SUCCESS;
+        bench_file(&result, path);
+        if (IS_AN_ERROR(result))
+        {
+            fprintf(stderr, "%s: ", path);
+            print_error(result);
+            failures++;
+        }
+    }
+    closedir(dir);
+    return failures == 0 ? 0 : 1;
+}
@@ -46,6 +46,20 @@
 #include <stdint.h>
 #include <ctype.h>
 #include <math.h>
+/* SIMD intrinsics for the batch Vec3 kernels */
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+#elif defined(__ARM_NEON)
+    #include <arm_neon.h>
+#endif
+/* Process fan-out and memory-mapped file access (posix only) */
+#ifndef _WIN32
+    #include <unistd.h>
+    #include <sys/wait.h>
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#endif
 /* The SDL2 Libraries */
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_mixer.h>
@@ -174,6 +188,36 @@ typedef uint32_t CanimResult;
 #define GET_XREF_STREAM_READ_ERROR 0x03000031 ///< Reading the file to store the xref stream failed
 #define GET_XREF_MALLOC_ERROR 0x03000032 ///< When getting the xref, allocating the PDFXref object failed
 #define GET_XREF_TABLE_ENTRIES_MALLOC_ERROR 0x03000033 ///< When getting the xref table entries, malloc failed
+#define TRI_RESERVE_REALLOC_ERROR 0x03000034 ///< When reserving capacity for a triangulation, realloc failed
+#define DEDUP_PSLG_HASH_MALLOC_ERROR 0x03000035 ///< When building the spatial hash for vertex dedup, malloc failed
+#define INDEXED_TRI_MALLOC_ERROR 0x03000036 ///< When building an indexed triangulation, malloc failed
+#define DRAW_INDEXED_TRIANGULATION_MALLOC_ERROR 0x03000037 ///< When drawing an indexed triangulation, malloc failed
+#define FFMPEG_WRITER_MALLOC_ERROR 0x03000038 ///< When setting up the async ffmpeg writer, malloc failed
+#define FFMPEG_WRITER_THREAD_ERROR 0x03000039 ///< When setting up the async ffmpeg writer, spawning the thread or its sync objects failed
+#define FFMPEG_WRITER_WRITE_ERROR 0x0300003a ///< The writer thread failed to push a frame into the ffmpeg pipe
+#define FRAMEBUFFER_READER_MAP_ERROR 0x0300003b ///< Mapping a pixel pack buffer for async readback failed
+#define OFF_READ_FILE_ERROR 0x0300003c ///< Slurping the off file into memory failed
+#define TRI_CACHE_READ_ERROR 0x0300003d ///< Allocating memory while loading the triangulation cache failed
+#define SPLIT_GRID_MALLOC_ERROR 0x0300003e ///< Allocating the intersection grid for pslg splitting failed
+#define ARENA_CHUNK_MALLOC_ERROR 0x0300003f ///< Allocating a chunk for an arena failed
+#define STL_BATCH_MALLOC_ERROR 0x03000040 ///< Allocating the stl serialization batch failed
+#define ANIMATION_SCHEDULER_MALLOC_ERROR 0x03000041 ///< Allocating the animation scheduler failed
+#define OFFSCREEN_TARGET_ERROR 0x03000042 ///< Building the offscreen render target failed
+#define PDF_DOC_OPEN_ERROR 0x03000043 ///< Opening the pdf file failed
+#define PDF_DOC_MALLOC_ERROR 0x03000044 ///< Allocating the pdf document handle failed
+#define PDF_OBJSTM_PARSE_ERROR 0x03000045 ///< Parsing an object stream failed
+#define SOA_TRIANGULATION_MALLOC_ERROR 0x03000046 ///< Allocating a struct-of-arrays triangulation failed
+#define SOUND_MIX_MALLOC_ERROR 0x03000047 ///< Allocating buffers for the audio mixdown failed
+#define SOUND_MIX_LOAD_ERROR 0x03000048 ///< Loading (or opening the mixer for) a sound failed
+#define SOUND_MIX_WRITE_ERROR 0x03000049 ///< Pushing the mixdown into the ffmpeg pipe failed
+#define CAMERA_PATH_MALLOC_ERROR 0x0300004a ///< Allocating a camera path failed
+#define ATTACK_ADJACENCY_MALLOC_ERROR 0x0300004b ///< Allocating the incidence structure for the vertex attacks failed
+#define MORPH_TRIANGULATION_MISMATCH_ERROR 0x0300004c ///< Morphing between triangulations whose triangle counts differ
+#define BATCH_MANIFEST_ERROR 0x0300004d ///< Opening or parsing the batch manifest failed
+#define BATCH_MALLOC_ERROR 0x0300004e ///< Allocating the batch job list failed
+#define PDF_FILE_MAP_ERROR 0x0300004f ///< Mapping or reading the pdf file into memory failed
+#define LOD_CHAIN_MALLOC_ERROR 0x03000050 ///< Allocating a level-of-detail chain failed
+#define TRI_CACHE_WRITE_ERROR 0x02000001 ///< Writing the triangulation cache failed (the render still goes on)
 
 #ifdef _WIN32
   #define POPEN  _popen
@@ -194,27 +238,57 @@ const char* triangulation_vs =
     "attribute vec3 position;\n"
     "attribute vec3 normal;\n"
     "attribute vec4 color;\n"
+    "uniform mat4 mvp;\n"
+    "uniform mat4 modelview;\n"
     "varying vec3 vNormal;\n"
     "varying vec3 vPos;\n"
     "varying vec4 vColor;\n"
     "void main()\n"
     "{\n"
-    "   gl_Position = gl_ModelViewProjectionMatrix * vec4(position, 1.0);\n"
-    "   vPos = vec3(gl_ModelViewMatrix * vec4(position, 1.0));\n"
-    "   vNormal = normalize(gl_NormalMatrix * normal);\n"
+    "   gl_Position = mvp * vec4(position, 1.0);\n"
+    "   vPos = vec3(modelview * vec4(position, 1.0));\n"
+    "   vNormal = normalize(mat3(modelview) * normal);\n"
     "	vColor = color;\n"
     "}\n";
 
-const char* triangulation_fs = 
+const char* triangulation_fs =
     "#version 120\n"
     "varying vec3 vNormal;\n"
     "varying vec3 vPos;\n"
     "varying vec4 vColor;\n"
-    "void main()" 
+    "void main()"
     "{\n"
     "   gl_FragColor = vColor;\n"
     "}\n";
 
+// the instanced variant pulls the model matrix and a color tint out of
+// per-instance attributes (attribute divisor 1), pairs with the same
+// fragment shader
+const char* triangulation_instanced_vs =
+    "#version 120\n"
+    "attribute vec3 position;\n"
+    "attribute vec3 normal;\n"
+    "attribute vec4 color;\n"
+    "attribute vec4 inst_col0;\n"
+    "attribute vec4 inst_col1;\n"
+    "attribute vec4 inst_col2;\n"
+    "attribute vec4 inst_col3;\n"
+    "attribute vec4 inst_tint;\n"
+    "uniform mat4 viewproj;\n"
+    "uniform mat4 view;\n"
+    "varying vec3 vNormal;\n"
+    "varying vec3 vPos;\n"
+    "varying vec4 vColor;\n"
+    "void main()\n"
+    "{\n"
+    "   mat4 model = mat4(inst_col0, inst_col1, inst_col2, inst_col3);\n"
+    "   vec4 world = model * vec4(position, 1.0);\n"
+    "   gl_Position = viewproj * world;\n"
+    "   vPos = vec3(view * world);\n"
+    "   vNormal = normalize(mat3(view) * mat3(model) * normal);\n"
+    "   vColor = color * inst_tint;\n"
+    "}\n";
+
 /** 
  * @brief Print out the error 
  * @param error The error the need be printed.
@@ -385,14 +459,212 @@ void print_error(CanimResult error)
         case GET_XREF_TABLE_ENTRIES_MALLOC_ERROR:
             fprintf(stderr, "When getting the xref table entries, malloc failed\n");
             break;
+        case TRI_RESERVE_REALLOC_ERROR:
+            fprintf(stderr, "When reserving capacity for a triangulation, realloc failed\n");
+            break;
+        case DEDUP_PSLG_HASH_MALLOC_ERROR:
+            fprintf(stderr, "When building the spatial hash for vertex dedup, malloc failed\n");
+            break;
+        case INDEXED_TRI_MALLOC_ERROR:
+            fprintf(stderr, "When building an indexed triangulation, malloc failed\n");
+            break;
+        case DRAW_INDEXED_TRIANGULATION_MALLOC_ERROR:
+            fprintf(stderr, "When drawing an indexed triangulation, malloc failed\n");
+            break;
+        case FFMPEG_WRITER_MALLOC_ERROR:
+            fprintf(stderr, "When setting up the async ffmpeg writer, malloc failed\n");
+            break;
+        case FFMPEG_WRITER_THREAD_ERROR:
+            fprintf(stderr, "When setting up the async ffmpeg writer, spawning the thread or its sync objects failed\n");
+            break;
+        case FFMPEG_WRITER_WRITE_ERROR:
+            fprintf(stderr, "The writer thread failed to push a frame into the ffmpeg pipe\n");
+            break;
+        case FRAMEBUFFER_READER_MAP_ERROR:
+            fprintf(stderr, "Mapping a pixel pack buffer for async readback failed\n");
+            break;
+        case OFF_READ_FILE_ERROR:
+            fprintf(stderr, "Slurping the off file into memory failed\n");
+            break;
+        case TRI_CACHE_READ_ERROR:
+            fprintf(stderr, "Allocating memory while loading the triangulation cache failed\n");
+            break;
+        case SPLIT_GRID_MALLOC_ERROR:
+            fprintf(stderr, "Allocating the intersection grid for pslg splitting failed\n");
+            break;
+        case ARENA_CHUNK_MALLOC_ERROR:
+            fprintf(stderr, "Allocating a chunk for an arena failed\n");
+            break;
+        case STL_BATCH_MALLOC_ERROR:
+            fprintf(stderr, "Allocating the stl serialization batch failed\n");
+            break;
+        case ANIMATION_SCHEDULER_MALLOC_ERROR:
+            fprintf(stderr, "Allocating the animation scheduler failed\n");
+            break;
+        case OFFSCREEN_TARGET_ERROR:
+            fprintf(stderr, "Building the offscreen render target failed\n");
+            break;
+        case PDF_DOC_OPEN_ERROR:
+            fprintf(stderr, "Opening the pdf file failed\n");
+            break;
+        case PDF_DOC_MALLOC_ERROR:
+            fprintf(stderr, "Allocating the pdf document handle failed\n");
+            break;
+        case PDF_OBJSTM_PARSE_ERROR:
+            fprintf(stderr, "Parsing an object stream failed\n");
+            break;
+        case SOA_TRIANGULATION_MALLOC_ERROR:
+            fprintf(stderr, "Allocating a struct-of-arrays triangulation failed\n");
+            break;
+        case SOUND_MIX_MALLOC_ERROR:
+            fprintf(stderr, "Allocating buffers for the audio mixdown failed\n");
+            break;
+        case SOUND_MIX_LOAD_ERROR:
+            fprintf(stderr, "Loading (or opening the mixer for) a sound failed\n");
+            break;
+        case SOUND_MIX_WRITE_ERROR:
+            fprintf(stderr, "Pushing the mixdown into the ffmpeg pipe failed\n");
+            break;
+        case CAMERA_PATH_MALLOC_ERROR:
+            fprintf(stderr, "Allocating a camera path failed\n");
+            break;
+        case ATTACK_ADJACENCY_MALLOC_ERROR:
+            fprintf(stderr, "Allocating the incidence structure for the vertex attacks failed\n");
+            break;
+        case MORPH_TRIANGULATION_MISMATCH_ERROR:
+            fprintf(stderr, "Morphing between triangulations whose triangle counts differ\n");
+            break;
+        case BATCH_MANIFEST_ERROR:
+            fprintf(stderr, "Opening or parsing the batch manifest failed\n");
+            break;
+        case BATCH_MALLOC_ERROR:
+            fprintf(stderr, "Allocating the batch job list failed\n");
+            break;
+        case PDF_FILE_MAP_ERROR:
+            fprintf(stderr, "Mapping or reading the pdf file into memory failed\n");
+            break;
+        case LOD_CHAIN_MALLOC_ERROR:
+            fprintf(stderr, "Allocating a level-of-detail chain failed\n");
+            break;
+        case TRI_CACHE_WRITE_ERROR:
+            fprintf(stderr, "Writing the triangulation cache failed (the render still goes on)\n");
+            break;
         default:
             fprintf(stderr, "SOMETHING BAD HAPPENED, WE DON'T KNOW WHAT");
             break;
-    } 
+    }
+}
+
+#ifndef NDEBUG
+
+/**
+ * @brief The instrumented stages
+ * @remark One slot per hot path; CANIM_PROF_BEGIN/END bracket a stage and
+ * CANIM_PROF_ALLOC charges bytes to it. Everything compiles out under
+ * NDEBUG (the release target), so shipping builds pay nothing.
+ */
+
+enum
+{
+    CANIM_PROF_TRIANGULATE,
+    CANIM_PROF_SPLIT,
+    CANIM_PROF_ATTACK,
+    CANIM_PROF_DRAW,
+    CANIM_PROF_FFMPEG,
+    CANIM_PROF_STAGE_COUNT
+};
+
+/**
+ * @brief One stage's accumulated counters
+ */
+
+typedef struct
+{
+    /**
+     *  @brief The stage name for the dump
+     *  */
+    const char* name;
+    /**
+     *  @brief How many times the stage ran
+     *  */
+    uint64_t calls;
+    /**
+     *  @brief Performance counter ticks spent inside it
+     *  */
+    uint64_t ticks;
+    /**
+     *  @brief Bytes charged to it via CANIM_PROF_ALLOC
+     *  */
+    uint64_t bytes;
+}
+CanimProfStage;
+
+/**
+ * @brief The counter table. Plain adds, not atomics: a worker race can
+ * drop a count now and then, which is a fine trade for staying under the
+ * 1% overhead budget on the hot paths.
+ */
+
+static CanimProfStage canim_prof_stages[CANIM_PROF_STAGE_COUNT] =
+{
+    { "triangulate_polyhedron", 0, 0, 0 },
+    { "split_entirely",         0, 0, 0 },
+    { "attack_vertex",          0, 0, 0 },
+    { "draw",                   0, 0, 0 },
+    { "ffmpeg_write",           0, 0, 0 },
+};
+
+/// @def CANIM_PROF_BEGIN
+/// @brief Opens a stage measurement; pair with CANIM_PROF_END in the same scope
+#define CANIM_PROF_BEGIN(stage) Uint64 canim_prof_t0_##stage = SDL_GetPerformanceCounter()
+
+/// @def CANIM_PROF_END
+/// @brief Closes a stage measurement and accumulates it
+#define CANIM_PROF_END(stage) do \
+{ \
+    canim_prof_stages[stage].calls++; \
+    canim_prof_stages[stage].ticks += SDL_GetPerformanceCounter() - canim_prof_t0_##stage; \
+} while (0)
+
+/// @def CANIM_PROF_ALLOC
+/// @brief Charges n freshly allocated bytes to a stage
+#define CANIM_PROF_ALLOC(stage, n) (canim_prof_stages[stage].bytes += (uint64_t)(n))
+
+/**
+ * @brief Dumps the counter table to stderr
+ * @return nothing
+ * @remark Registered with atexit by CANIM_PROF_INSTALL in main.
+ */
+
+static void canim_prof_dump(void)
+{
+    double freq = (double)SDL_GetPerformanceFrequency();
+    fprintf(stderr, "%-24s %12s %12s %14s\n", "stage", "calls", "seconds", "bytes");
+    for (int i = 0; i < CANIM_PROF_STAGE_COUNT; i++)
+    {
+        fprintf(stderr, "%-24s %12llu %12.4f %14llu\n",
+            canim_prof_stages[i].name,
+            (unsigned long long)canim_prof_stages[i].calls,
+            canim_prof_stages[i].ticks / freq,
+            (unsigned long long)canim_prof_stages[i].bytes);
+    }
 }
 
+/// @def CANIM_PROF_INSTALL
+/// @brief Registers the table dump to run at exit
+#define CANIM_PROF_INSTALL() atexit(canim_prof_dump)
+
+#else
+
+#define CANIM_PROF_BEGIN(stage)
+#define CANIM_PROF_END(stage)
+#define CANIM_PROF_ALLOC(stage, n)
+#define CANIM_PROF_INSTALL()
+
+#endif
+
 /**
- * @brief A 3 dimensional vector 
+ * @brief A 3 dimensional vector
  */
 
 typedef struct 
@@ -570,11 +842,52 @@ typedef struct
 } 
 Polyhedron;
 
+/**
+ * @brief One block of arena memory, chained newest-first
+ */
+
+typedef struct ArenaChunk
+{
+    /**
+     *  @brief The next (older) chunk
+     *  */
+    struct ArenaChunk* next;
+    /**
+     *  @brief How many bytes this chunk holds
+     *  */
+    size_t capacity;
+    /**
+     *  @brief How many bytes are already handed out
+     *  */
+    size_t used;
+    /**
+     *  @brief The memory itself
+     *  */
+    unsigned char data[];
+}
+ArenaChunk;
+
+/**
+ * @brief A bump allocator for the per-face triangulation pipeline
+ * @remark Zero-initialize it, hand out memory with @ref arena_alloc, and
+ * throw everything back at once with @ref arena_reset. Nothing allocated
+ * from an arena is ever freed individually.
+ */
+
+typedef struct
+{
+    /**
+     *  @brief The chunk list, newest first (null until the first alloc)
+     *  */
+    ArenaChunk* chunks;
+}
+Arena;
+
 /**
  * @brief A Point Set Linear Graph (pslg)
  */
 
-typedef struct 
+typedef struct
 {
     /**
      *  @brief The vertices
@@ -596,9 +909,57 @@ typedef struct
      * @brief The old face
      */
     PolygonRaw poly;
-} 
+    /**
+     * @brief The arena everything in here lives in
+     */
+    Arena* arena;
+}
 PSLG;
 
+/**
+ * @brief The GPU residency of a triangulation
+ * @remark A zeroed TriangulationGPU means "nothing uploaded yet". The handles
+ * are created lazily on the first draw and reused until the triangulation is
+ * mutated (which clears @ref uploaded) or freed.
+ */
+
+typedef struct
+{
+    /**
+     *  @brief The vertex array object (0 if never created)
+     *  */
+    GLuint vao;
+    /**
+     *  @brief The vertex buffer object (0 if never created)
+     *  */
+    GLuint vbo;
+    /**
+     *  @brief The number of triangles currently living in the vbo
+     *  */
+    int uploaded_count;
+    /**
+     *  @brief Whether the vbo contents match the triangles
+     *  */
+    bool uploaded;
+    /**
+     *  @brief First triangle whose vbo bytes are stale (dirty range start)
+     *  */
+    int dirty_min;
+    /**
+     *  @brief One past the last stale triangle (equal to dirty_min = clean)
+     *  */
+    int dirty_max;
+    /**
+     *  @brief The per-instance attribute buffer (0 if never drawn instanced)
+     *  */
+    GLuint instance_vbo;
+    /**
+     *  @brief How many instances fit in it before it has to grow
+     *  */
+    int instance_capacity;
+}
+TriangulationGPU;
+
 /**
  * @brief A triangulation
  */
@@ -613,9 +974,117 @@ typedef struct
      *  @brief The number of triangles
      *  */
     int triangle_count;
+    /**
+     *  @brief How many triangles fit before the next realloc
+     *  */
+    int triangle_capacity;
+    /**
+     *  @brief The cached GPU buffers (see TriangulationGPU)
+     *  */
+    TriangulationGPU gpu;
 }
 Triangulation;
 
+/**
+ * @brief A triangulation in struct-of-arrays form
+ * @remark Positions, normals, and colors live in separate arrays, so the
+ * geometry passes that only touch positions stop dragging face data
+ * through cache (TriangleRaw wastes over half of every line there). The
+ * interleaved GPU vertex buffer gets rebuilt from the three arrays on
+ * upload, same lazy scheme as Triangulation.
+ */
+
+typedef struct
+{
+    /**
+     *  @brief The vertex positions, three per triangle
+     *  */
+    Vec3* positions;
+    /**
+     *  @brief The face normals, one per triangle
+     *  */
+    Vec3* normals;
+    /**
+     *  @brief The face colors, one per triangle
+     *  */
+    Color* colors;
+    /**
+     *  @brief The number of triangles
+     *  */
+    int triangle_count;
+    /**
+     *  @brief How many triangles fit before the next realloc
+     *  */
+    int triangle_capacity;
+    /**
+     *  @brief The cached GPU buffers (see TriangulationGPU)
+     *  */
+    TriangulationGPU gpu;
+}
+TriangulationSoA;
+
+/**
+ * @brief The GPU residency of an indexed triangulation
+ * @remark Same lazy-upload scheme as TriangulationGPU, plus an index
+ * buffer so shared vertices actually go through the GPU vertex cache.
+ */
+
+typedef struct
+{
+    /**
+     *  @brief The vertex array object (0 if never created)
+     *  */
+    GLuint vao;
+    /**
+     *  @brief The vertex buffer object (0 if never created)
+     *  */
+    GLuint vbo;
+    /**
+     *  @brief The index buffer object (0 if never created)
+     *  */
+    GLuint ibo;
+    /**
+     *  @brief The number of indices currently living in the ibo
+     *  */
+    int index_count;
+    /**
+     *  @brief Whether the buffers match the triangles
+     *  */
+    bool uploaded;
+}
+IndexedTriangulationGPU;
+
+/**
+ * @brief A triangulation over a shared vertex pool
+ * @remark Each shared vertex is stored once instead of once per triangle
+ * it appears in, which is roughly a 3-4x memory cut on closed meshes.
+ */
+
+typedef struct
+{
+    /**
+     *  @brief The vertex pool
+     *  */
+    Vec3* vertices;
+    /**
+     *  @brief The number of vertices in the pool
+     *  */
+    int vertex_count;
+    /**
+     *  @brief The triangles (indices into the pool plus face data)
+     *  */
+    TriangleIndexed* triangles;
+    /**
+     *  @brief The number of triangles
+     *  */
+    int triangle_count;
+    /**
+     *  @brief The cached GPU buffers (see IndexedTriangulationGPU)
+     *  */
+    IndexedTriangulationGPU gpu;
+}
+IndexedTriangulation;
+
 /**
  * @brief A Quaternion
  */
@@ -993,29 +1462,58 @@ long read_be_int(const unsigned char* p, int width)
  * @return The decompressed stream
  */
 
-unsigned char* decompress_flate(CanimResult* result, unsigned char* input, size_t input_len, size_t* output_len)
+unsigned char* decompress_flate(CanimResult* result, const unsigned char* input, size_t input_len, size_t* output_len)
 {
-    size_t buf_size = input_len * 8; 
+    // start modest and grow geometrically; the old 8x guess both wasted
+    // memory on small streams and flatly refused anything that expanded more
+    size_t buf_size = input_len * 2 + 64;
     unsigned char* output = malloc(buf_size);
-    if (!output) 
+    if (!output)
     {
         *result = STREAM_DECOMPRESS_MALLOC_FAIL;
         return null;
     }
     z_stream strm = {0};
-    strm.next_in = input;
+    // zlib never writes through next_in, its type just predates const
+    strm.next_in = (unsigned char*)input;
     strm.avail_in = input_len;
-    strm.next_out = output;
-    strm.avail_out = buf_size;
-    if (inflateInit(&strm) != Z_OK) 
+    if (inflateInit(&strm) != Z_OK)
     {
         free(output);
         *result = STREAM_DECOMPRESS_INIT_FAIL;
         return null;
     }
-    int ret = inflate(&strm, Z_FINISH);
-    if (ret != Z_STREAM_END) 
+    for (;;)
     {
+        strm.next_out = output + strm.total_out;
+        strm.avail_out = buf_size - strm.total_out;
+        int ret = inflate(&strm, Z_NO_FLUSH);
+        if (ret == Z_STREAM_END)
+        {
+            break;
+        }
+        if (ret != Z_OK && ret != Z_BUF_ERROR)
+        {
+            inflateEnd(&strm);
+            free(output);
+            *result = STREAM_DECOMPRESS_FAIL;
+            return null;
+        }
+        if (strm.avail_out == 0)
+        {
+            buf_size *= 2;
+            unsigned char* temp = realloc(output, buf_size);
+            if (!temp)
+            {
+                inflateEnd(&strm);
+                free(output);
+                *result = STREAM_DECOMPRESS_MALLOC_FAIL;
+                return null;
+            }
+            output = temp;
+            continue;
+        }
+        // room left but no progress possible: the input is truncated
         inflateEnd(&strm);
         free(output);
         *result = STREAM_DECOMPRESS_FAIL;
@@ -1023,6 +1521,15 @@ unsigned char* decompress_flate(CanimResult* result, unsigned char* input, size_
     }
     *output_len = strm.total_out;
     inflateEnd(&strm);
+    if (buf_size > *output_len)
+    {
+        // trim to the final size; a failed shrink just keeps the slack
+        unsigned char* temp = realloc(output, max(*output_len, 1));
+        if (temp)
+        {
+            output = temp;
+        }
+    }
     *result = SUCCESS;
     return output;
 }
@@ -1045,55 +1552,171 @@ unsigned char* next_str(CanimResult* result, unsigned char* c)
 }
 
 /**
- * @brief This grabs the location of the xref table in a PDF file
- * @param[out] result The success/failing
- * @param f The PDF file
- * @return The offset
+ * @brief A whole pdf mapped into memory
+ * @remark On posix this is a real mmap: the startxref scan is a pointer
+ * search over the mapped tail, stream bytes feed zlib straight from the
+ * mapping with no intermediate copy, and the page cache makes repeated
+ * extraction runs over the same pdf close to free. Windows (and the
+ * rare filesystem that refuses to map) falls back to slurping the file
+ * into one malloc'd buffer, which the rest of the code can't tell apart.
+ */
+
+typedef struct
+{
+    /**
+     * @brief The file bytes, read only
+     */
+    const unsigned char* data;
+    /**
+     * @brief How many of them there are
+     */
+    size_t size;
+    /**
+     * @brief Whether @ref data is an mmap (munmap) or a slurp (free)
+     */
+    bool mapped;
+}
+PDFFile;
+
+/**
+ * @brief Maps (or, failing that, slurps) a pdf into memory
+ * @param[out] result The status
+ * @param pf The file handle to fill in
+ * @param path The pdf path
+ * @return nothing
  */
 
-long findxref(CanimResult* result, FILE* f)
+void pdf_file_open(CanimResult* result, PDFFile* pf, const char* path)
 {
-    char buf[BUFFER_SIZE + 1];
-    long filesize;
-    if (fseek(f, 0, SEEK_END) != 0) 
+    pf->data = null;
+    pf->size = 0;
+    pf->mapped = false;
+#ifndef _WIN32
+    int fd = open(path, O_RDONLY);
+    if (fd >= 0)
+    {
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0)
+        {
+            void* map = mmap(null, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (map != MAP_FAILED)
+            {
+                // the mapping outlives the descriptor
+                close(fd);
+                pf->data = map;
+                pf->size = (size_t)st.st_size;
+                pf->mapped = true;
+                *result = SUCCESS;
+                return;
+            }
+        }
+        close(fd);
+    }
+#endif
+    FILE* f = fopen(path, "rb");
+    if (!f)
     {
-        *result = PDF_XREF_FIND_SEEK_END_ERROR;
-        return -1;
+        *result = PDF_DOC_OPEN_ERROR;
+        return;
     }
-    filesize = ftell(f);
-    if (filesize < 0) 
+    if (fseek(f, 0, SEEK_END) != 0)
     {
-        *result = PDF_XREF_FIND_FTELL_ERROR;
-        return -1;
+        fclose(f);
+        *result = PDF_FILE_MAP_ERROR;
+        return;
     }
-    if (fseek(f, max(filesize - BUFFER_SIZE, 0), SEEK_SET) != 0) 
+    long filesize = ftell(f);
+    if (filesize < 1 || fseek(f, 0, SEEK_SET) != 0)
     {
-        *result = PDF_XREF_FIND_SEEK_SET_ERROR;
-        return -1;
+        fclose(f);
+        *result = PDF_FILE_MAP_ERROR;
+        return;
     }
-    size_t n = fread(buf, sizeof(char), BUFFER_SIZE, f);
-    if (n == 0 && ferror(f))
+    unsigned char* buf = malloc(filesize);
+    if (!buf)
     {
-        *result = PDF_XREF_FIND_FREAD_ERROR;
-        return -1;
+        fclose(f);
+        *result = PDF_FILE_MAP_ERROR;
+        return;
     }
-    buf[n] = '\0';
-    /* This keeps is because files tend to randomly have a lot of '\0', we get rid of them */
-    for (size_t i = 0; i < n; i++)
+    if (fread(buf, 1, filesize, f) != (size_t)filesize)
     {
-        if (buf[i] == '\0')
-        {
-             buf[i] = 1; 
+        free(buf);
+        fclose(f);
+        *result = PDF_FILE_MAP_ERROR;
+        return;
+    }
+    fclose(f);
+    pf->data = buf;
+    pf->size = (size_t)filesize;
+    *result = SUCCESS;
+}
+
+/**
+ * @brief Unmaps (or frees) a pdf
+ * @param pf The file handle (an empty one is fine)
+ * @return nothing
+ */
+
+void pdf_file_close(PDFFile* pf)
+{
+    if (!pf->data)
+    {
+        return;
+    }
+#ifndef _WIN32
+    if (pf->mapped)
+    {
+        munmap((void*)pf->data, pf->size);
+        pf->data = null;
+        return;
+    }
+#endif
+    free((void*)pf->data);
+    pf->data = null;
+}
+
+/**
+ * @brief This grabs the location of the xref table in a PDF file
+ * @param[out] result The success/failing
+ * @param pf The mapped PDF file
+ * @return The offset
+ * @remark A backwards memcmp over the mapped tail, so embedded '\0'
+ * bytes (which the old strstr window had to scrub out) are a non-issue,
+ * and the last startxref wins like the spec wants.
+ */
+
+long findxref(CanimResult* result, const PDFFile* pf)
+{
+    size_t tail = pf->size < BUFFER_SIZE ? pf->size : BUFFER_SIZE;
+    const unsigned char* start = pf->data + pf->size - tail;
+    const unsigned char* pos = null;
+    for (size_t i = tail; i >= 9; i--)
+    {
+        if (memcmp(start + i - 9, "startxref", 9) == 0)
+        {
+            pos = start + i - 9;
+            break;
         }
     }
-    char *pos = strstr(buf, "startxref");
     if (!pos)
     {
         *result = PDF_XREF_STARTXREF_NOT_FOUND;
         return -1;
     }
+    // bounded by hand because the mapping has no terminator to lean on
+    const unsigned char* p = pos + 9;
+    const unsigned char* end = pf->data + pf->size;
+    for (;p < end && (*p == '\r' || *p == '\n' || *p == ' ' || *p == '\t');)
+    {
+        p++;
+    }
     long offset = -1;
-    if (sscanf(pos + 9, "%ld", &offset) != 1) 
+    for (;p < end && *p >= '0' && *p <= '9'; p++)
+    {
+        offset = (offset < 0 ? 0 : offset) * 10 + (*p - '0');
+    }
+    if (offset < 0 || (size_t)offset >= pf->size)
     {
         *result = PDF_XREF_OFFSET_PARSE_ERROR;
         return -1;
@@ -1111,51 +1734,44 @@ long findxref(CanimResult* result, FILE* f)
 
 void test_findxref(CanimResult* result)
 {
-    FILE* f = fopen("8.pdf", "rb");
-    if(!f)
+    PDFFile pf;
+    pdf_file_open(result, &pf, "8.pdf");
+    if(IS_AN_ERROR(*result))
     {
         fprintf(stderr, "I am sorry :(\n");
         return;
     }
-    long offset = findxref(result, f);
+    long offset = findxref(result, &pf);
     if(IS_AN_ERROR(*result))
     {
         print_error(*result);
+        pdf_file_close(&pf);
         return;
     }
-    fseek(f, offset, SEEK_SET);
-    char a[2000];
-    fread(a, sizeof(char), 2000, f);
-    fwrite(a, sizeof(char), 2000, stdout);
-    fclose(f);
+    size_t n = pf.size - offset < 2000 ? pf.size - offset : 2000;
+    fwrite(pf.data + offset, sizeof(char), n, stdout);
+    pdf_file_close(&pf);
 }
 
 /**
- * @brief This gets the xref 
+ * @brief This gets the xref
  * @param[out] result
- * @param f File
+ * @param pf The mapped PDF file
  * @return the xref
  */
 
-PDFXref* get_xref(CanimResult* result, FILE* f)
+PDFXref* get_xref(CanimResult* result, const PDFFile* pf)
 {
-    long offset = findxref(result, f);
+    long offset = findxref(result, pf);
     if (IS_AN_ERROR(*result))
     {
         return null;
     }
-    char buf[BUFFER_SIZE];
-    if(fseek(f, offset, SEEK_SET) != 0)
-    {
-        *result = GET_XREF_FSEEK_ERROR;
-        return null;
-    }
-    size_t n = fread(buf, sizeof(char), BUFFER_SIZE, f);
-    if (n == 0 && ferror(f))
-    {
-        *result = GET_XREF_FREAD_ERROR;
-        return null;
-    }
+    // the dict header is tiny, so copy a window of it for the sake of the
+    // terminated strstr/sscanf parse; only the stream body stays zero copy
+    char buf[BUFFER_SIZE + 1];
+    size_t n = pf->size - offset < BUFFER_SIZE ? pf->size - offset : BUFFER_SIZE;
+    memcpy(buf, pf->data + offset, n);
     buf[n] = '\0';
     char* p = buf;
 
@@ -1164,22 +1780,22 @@ PDFXref* get_xref(CanimResult* result, FILE* f)
         *result = GET_XREF_STRCHR_NEWLINE_FAIL;
         return null;
     }
-    p++; 
+    p++;
     p = strchr(p, '\n');
     if (!p) {
         *result = GET_XREF_STRCHR_NEWLINE_FAIL;
         return null;
     }
-    p++; 
+    p++;
     char* q;
     int size = 0;
     int w0 = 0;
-    int w1 = 0; 
+    int w1 = 0;
     int w2 = 0;
     long length = 0;
     int root_obj = 0;
     int root_gen = 0;
-    if ((q = strstr(p, "/Size")))  
+    if ((q = strstr(p, "/Size")))
     {
         sscanf(q, "/Size %d", &size);
     }
@@ -1187,11 +1803,11 @@ PDFXref* get_xref(CanimResult* result, FILE* f)
     {
         sscanf(q, "/Length %ld", &length);
     }
-    if ((q = strstr(p, "/W")))     
+    if ((q = strstr(p, "/W")))
     {
         sscanf(q, "/W [%d %d %d]", &w0, &w1, &w2);
     }
-    if ((q = strstr(p, "/Root")))  
+    if ((q = strstr(p, "/Root")))
     {
         sscanf(q, "/Root %d %d R", &root_obj, &root_gen);
     }
@@ -1203,27 +1819,14 @@ PDFXref* get_xref(CanimResult* result, FILE* f)
     q+=7;
     long dict_offset_in_buf = (q - buf);
     long file_data_start = offset + dict_offset_in_buf;
-    if (fseek(f, file_data_start, SEEK_SET) != 0) 
-    {
-        *result = GET_XREF_STREAM_SEEK_ERROR;
-        return null;
-    }
-    unsigned char *raw = malloc(length);
-    if (!raw) 
-    {
-        *result = GET_XREF_STREAM_MALLOC_ERROR;
-        return null;
-    }
-    size_t read_bytes = fread(raw, 1, length, f);
-    if (read_bytes != (size_t)length) 
+    if (length < 1 || (size_t)file_data_start + (size_t)length > pf->size)
     {
         *result = GET_XREF_STREAM_READ_ERROR;
-        free(raw);
         return null;
     }
     size_t decomp_len = 0;
-    unsigned char* decomp = decompress_flate(result, raw, length, &decomp_len);
-    free(raw);
+    // straight from the mapping into zlib, no staging buffer
+    unsigned char* decomp = decompress_flate(result, pf->data + file_data_start, length, &decomp_len);
 
     if (IS_AN_ERROR(*result)) {
         return null;
@@ -1260,6 +1863,322 @@ PDFXref* get_xref(CanimResult* result, FILE* f)
     return xref;
 }
 
+/**
+ * @brief An open pdf with its xref parsed once and its object streams
+ * inflated at most once
+ * @remark The figure extraction pass probes the same objects over and
+ * over; going back through findxref and inflate each time was most of the
+ * cost. The memo table is indexed by object number.
+ */
+
+typedef struct
+{
+    /**
+     *  @brief The mapped file, kept around for lazy stream loads
+     *  */
+    PDFFile file;
+    /**
+     *  @brief The xref, parsed once at open
+     *  */
+    PDFXref* xref;
+    /**
+     *  @brief Memoized object streams, indexed by object number (null
+     *  until first access)
+     *  */
+    PDFObjStream** streams;
+}
+PDFDocument;
+
+/**
+ * @brief Opens a pdf and parses its xref once
+ * @param[out] result The status
+ * @param path The pdf path
+ * @return The document handle
+ */
+
+PDFDocument* open_pdf_document(CanimResult* result, const char* path)
+{
+    PDFFile pf;
+    pdf_file_open(result, &pf, path);
+    if (IS_AN_ERROR(*result))
+    {
+        return null;
+    }
+    PDFXref* xref = get_xref(result, &pf);
+    if (IS_AN_ERROR(*result))
+    {
+        pdf_file_close(&pf);
+        return null;
+    }
+    PDFDocument* doc = malloc(sizeof(PDFDocument));
+    PDFObjStream** streams = calloc(max(xref->tb.size, 1), sizeof(PDFObjStream*));
+    if (!doc || !streams)
+    {
+        free(doc);
+        free(streams);
+        free(xref->tb.entries);
+        free(xref);
+        pdf_file_close(&pf);
+        *result = PDF_DOC_MALLOC_ERROR;
+        return null;
+    }
+    doc->file = pf;
+    doc->xref = xref;
+    doc->streams = streams;
+    *result = SUCCESS;
+    return doc;
+}
+
+/**
+ * @brief Frees one object stream
+ * @param stm The stream (null is fine)
+ * @return nothing
+ */
+
+static void free_obj_stream(PDFObjStream* stm)
+{
+    if (!stm)
+    {
+        return;
+    }
+    free(stm->index);
+    if (stm->flate)
+    {
+        // uncompressed streams point straight into the mapping
+        free(stm->data);
+    }
+    free(stm);
+}
+
+/**
+ * @brief Loads an object stream from the file, for the cache miss path
+ * @param[out] result The status
+ * @param doc The document
+ * @param obj_num The object number of the stream itself
+ * @return The freshly parsed stream
+ */
+
+static PDFObjStream* load_obj_stream(CanimResult* result, PDFDocument* doc, int obj_num)
+{
+    long offset = doc->xref->tb.entries[obj_num].offset;
+    if (offset < 0 || (size_t)offset >= doc->file.size)
+    {
+        *result = PDF_OBJSTM_PARSE_ERROR;
+        return null;
+    }
+    // same header-window trick as get_xref: copy the tiny dict so the
+    // terminated parse works, leave the stream body in the mapping
+    char buf[BUFFER_SIZE + 1];
+    size_t n = doc->file.size - offset < BUFFER_SIZE ? doc->file.size - offset : BUFFER_SIZE;
+    memcpy(buf, doc->file.data + offset, n);
+    buf[n] = '\0';
+    int count = 0;
+    int first_offset = 0;
+    long length = 0;
+    char* q;
+    if ((q = strstr(buf, "/N")))
+    {
+        sscanf(q, "/N %d", &count);
+    }
+    if ((q = strstr(buf, "/First")))
+    {
+        sscanf(q, "/First %d", &first_offset);
+    }
+    if ((q = strstr(buf, "/Length")))
+    {
+        sscanf(q, "/Length %ld", &length);
+    }
+    bool flate = strstr(buf, "/FlateDecode") != null;
+    q = strstr(buf, "stream");
+    if (!q || count < 1 || length < 1)
+    {
+        *result = PDF_OBJSTM_PARSE_ERROR;
+        return null;
+    }
+    q += 7;
+    size_t body_start = (size_t)offset + (size_t)(q - buf);
+    if (body_start + (size_t)length > doc->file.size)
+    {
+        *result = PDF_OBJSTM_PARSE_ERROR;
+        return null;
+    }
+    const unsigned char* raw = doc->file.data + body_start;
+    unsigned char* data;
+    size_t data_len;
+    if (flate)
+    {
+        // the mapping feeds zlib directly, no staging buffer
+        data = decompress_flate(result, raw, length, &data_len);
+        if (IS_AN_ERROR(*result))
+        {
+            return null;
+        }
+    }
+    else
+    {
+        // already plain bytes: the stream IS the mapping, zero copies
+        data = (unsigned char*)raw;
+        data_len = length;
+    }
+    PDFObjStream* stm = malloc(sizeof(PDFObjStream));
+    PDFObjStreamIndex* index = malloc(count * sizeof(PDFObjStreamIndex));
+    if (!stm || !index)
+    {
+        free(stm);
+        free(index);
+        if (flate)
+        {
+            free(data);
+        }
+        *result = PDF_DOC_MALLOC_ERROR;
+        return null;
+    }
+    // the stream opens with count pairs of "obj_num offset"
+    char* p = (char*)data;
+    for (int i = 0; i < count; i++)
+    {
+        char* end;
+        index[i].obj_num = (int)strtol(p, &end, 10);
+        if (end == p)
+        {
+            free(stm);
+            free(index);
+            if (flate)
+            {
+                free(data);
+            }
+            *result = PDF_OBJSTM_PARSE_ERROR;
+            return null;
+        }
+        p = end;
+        index[i].offset = (int)strtol(p, &end, 10);
+        if (end == p)
+        {
+            free(stm);
+            free(index);
+            if (flate)
+            {
+                free(data);
+            }
+            *result = PDF_OBJSTM_PARSE_ERROR;
+            return null;
+        }
+        p = end;
+    }
+    stm->count = count;
+    stm->first_offset = first_offset;
+    stm->length = length;
+    stm->flate = flate;
+    stm->index = index;
+    stm->data = data;
+    stm->data_len = data_len;
+    *result = SUCCESS;
+    return stm;
+}
+
+/**
+ * @brief Gets an object stream, inflating it only on the first call
+ * @param[out] result The status
+ * @param doc The document
+ * @param obj_num The object number of the stream
+ * @return The memoized stream; later calls are a table probe
+ */
+
+PDFObjStream* pdf_document_obj_stream(CanimResult* result, PDFDocument* doc, int obj_num)
+{
+    if (obj_num < 0 || obj_num >= doc->xref->tb.size)
+    {
+        *result = PDF_OBJSTM_PARSE_ERROR;
+        return null;
+    }
+    if (doc->streams[obj_num])
+    {
+        *result = SUCCESS;
+        return doc->streams[obj_num];
+    }
+    PDFObjStream* stm = load_obj_stream(result, doc, obj_num);
+    if (IS_AN_ERROR(*result))
+    {
+        return null;
+    }
+    doc->streams[obj_num] = stm;
+    return stm;
+}
+
+/**
+ * @brief Looks up a compressed (type 2) object inside its object stream
+ * @param[out] result The status
+ * @param doc The document
+ * @param obj_num The object number
+ * @param[out] len How many bytes the object spans (to the next one)
+ * @return A pointer into the memoized stream data, or null
+ * @remark NOOP for free or uncompressed entries; the caller reads those
+ * straight from the file via the xref offset like before.
+ */
+
+const unsigned char* pdf_document_object(CanimResult* result, PDFDocument* doc, int obj_num, size_t* len)
+{
+    if (obj_num < 0 || obj_num >= doc->xref->tb.size)
+    {
+        *result = PDF_OBJSTM_PARSE_ERROR;
+        return null;
+    }
+    PDFXrefEntry* entry = &doc->xref->tb.entries[obj_num];
+    if (entry->type != 2)
+    {
+        *result = NOOP;
+        return null;
+    }
+    // for type 2 the offset field is the container stream's object number
+    // and the generation field is the index within it
+    PDFObjStream* stm = pdf_document_obj_stream(result, doc, (int)entry->offset);
+    if (IS_AN_ERROR(*result))
+    {
+        return null;
+    }
+    int idx = entry->generation;
+    if (idx < 0 || idx >= stm->count)
+    {
+        *result = PDF_OBJSTM_PARSE_ERROR;
+        return null;
+    }
+    size_t start = (size_t)stm->first_offset + stm->index[idx].offset;
+    size_t end = idx + 1 < stm->count
+        ? (size_t)stm->first_offset + stm->index[idx + 1].offset
+        : stm->data_len;
+    if (start > stm->data_len || end > stm->data_len || end < start)
+    {
+        *result = PDF_OBJSTM_PARSE_ERROR;
+        return null;
+    }
+    *len = end - start;
+    *result = SUCCESS;
+    return stm->data + start;
+}
+
+/**
+ * @brief Closes the document and frees the xref and every cached stream
+ * @param doc The document (null is fine)
+ * @return nothing
+ */
+
+void free_pdf_document(PDFDocument* doc)
+{
+    if (!doc)
+    {
+        return;
+    }
+    for (int i = 0; i < doc->xref->tb.size; i++)
+    {
+        free_obj_stream(doc->streams[i]);
+    }
+    free(doc->streams);
+    free(doc->xref->tb.entries);
+    free(doc->xref);
+    pdf_file_close(&doc->file);
+    free(doc);
+}
+
 PFNGLUNIFORM1IPROC                pglUniform1i;
 PFNGLUNIFORM1FPROC                pglUniform1f;
 PFNGLUNIFORM3FPROC                pglUniform3f;
@@ -1292,9 +2211,25 @@ PFNGLGETPROGRAMINFOLOGPROC        pglGetProgramInfoLog;
 PFNGLGETATTRIBLOCATIONPROC        pglGetAttribLocation;
 PFNGLGETUNIFORMLOCATIONPROC       pglGetUniformLocation;
 PFNGLDELETEVERTEXARRAYSPROC       pglDeleteVertexArrays;
+PFNGLMAPBUFFERPROC                pglMapBuffer;
+PFNGLUNMAPBUFFERPROC              pglUnmapBuffer;
 PFNGLVERTEXATTRIBPOINTERPROC      pglVertexAttribPointer;
 PFNGLENABLEVERTEXATTRIBARRAYPROC  pglEnableVertexAttribArray;
 PFNGLDISABLEVERTEXATTRIBARRAYPROC pglDisableVertexAttribArray;
+PFNGLGENFRAMEBUFFERSPROC          pglGenFramebuffers;
+PFNGLBINDFRAMEBUFFERPROC          pglBindFramebuffer;
+PFNGLDELETEFRAMEBUFFERSPROC       pglDeleteFramebuffers;
+PFNGLGENRENDERBUFFERSPROC         pglGenRenderbuffers;
+PFNGLBINDRENDERBUFFERPROC         pglBindRenderbuffer;
+PFNGLDELETERENDERBUFFERSPROC      pglDeleteRenderbuffers;
+PFNGLFRAMEBUFFERRENDERBUFFERPROC  pglFramebufferRenderbuffer;
+PFNGLCHECKFRAMEBUFFERSTATUSPROC   pglCheckFramebufferStatus;
+PFNGLBLITFRAMEBUFFERPROC          pglBlitFramebuffer;
+PFNGLRENDERBUFFERSTORAGEPROC      pglRenderbufferStorage;
+PFNGLRENDERBUFFERSTORAGEMULTISAMPLEPROC pglRenderbufferStorageMultisample;
+PFNGLBUFFERSUBDATAPROC            pglBufferSubData;
+PFNGLVERTEXATTRIBDIVISORPROC      pglVertexAttribDivisor;
+PFNGLDRAWARRAYSINSTANCEDPROC      pglDrawArraysInstanced;
 
 #define LOAD_GL(type, var, name) do {var = (type)(uintptr_t)SDL_GL_GetProcAddress(name);  if (!var) {*result = LOAD_OPENGL_FUNCTION_ERROR; return; } } while(0)
 
@@ -1317,6 +2252,8 @@ void load_gl_shader_functions(CanimResult* result)
     LOAD_GL(PFNGLUNIFORM3FVPROC,               pglUniform3fv,               "glUniform3fv");
     LOAD_GL(PFNGLBINDBUFFERPROC,               pglBindBuffer,               "glBindBuffer");
     LOAD_GL(PFNGLBUFFERDATAPROC,               pglBufferData,               "glBufferData");
+    LOAD_GL(PFNGLMAPBUFFERPROC,                pglMapBuffer,                "glMapBuffer");
+    LOAD_GL(PFNGLUNMAPBUFFERPROC,              pglUnmapBuffer,              "glUnmapBuffer");
     LOAD_GL(PFNGLGETSHADERIVPROC,              pglGetShaderiv,              "glGetShaderiv");
     LOAD_GL(PFNGLLINKPROGRAMPROC,              pglLinkProgram,              "glLinkProgram");
     LOAD_GL(PFNGLCREATESHADERPROC,             pglCreateShader,             "glCreateShader");
@@ -1341,6 +2278,20 @@ void load_gl_shader_functions(CanimResult* result)
     LOAD_GL(PFNGLVERTEXATTRIBPOINTERPROC,      pglVertexAttribPointer,      "glVertexAttribPointer");
     LOAD_GL(PFNGLENABLEVERTEXATTRIBARRAYPROC,  pglEnableVertexAttribArray,  "glEnableVertexAttribArray");
     LOAD_GL(PFNGLDISABLEVERTEXATTRIBARRAYPROC, pglDisableVertexAttribArray, "glDisableVertexAttribArray");
+    LOAD_GL(PFNGLGENFRAMEBUFFERSPROC,          pglGenFramebuffers,          "glGenFramebuffers");
+    LOAD_GL(PFNGLBINDFRAMEBUFFERPROC,          pglBindFramebuffer,          "glBindFramebuffer");
+    LOAD_GL(PFNGLDELETEFRAMEBUFFERSPROC,       pglDeleteFramebuffers,       "glDeleteFramebuffers");
+    LOAD_GL(PFNGLGENRENDERBUFFERSPROC,         pglGenRenderbuffers,         "glGenRenderbuffers");
+    LOAD_GL(PFNGLBINDRENDERBUFFERPROC,         pglBindRenderbuffer,         "glBindRenderbuffer");
+    LOAD_GL(PFNGLDELETERENDERBUFFERSPROC,      pglDeleteRenderbuffers,      "glDeleteRenderbuffers");
+    LOAD_GL(PFNGLFRAMEBUFFERRENDERBUFFERPROC,  pglFramebufferRenderbuffer,  "glFramebufferRenderbuffer");
+    LOAD_GL(PFNGLCHECKFRAMEBUFFERSTATUSPROC,   pglCheckFramebufferStatus,   "glCheckFramebufferStatus");
+    LOAD_GL(PFNGLBLITFRAMEBUFFERPROC,          pglBlitFramebuffer,          "glBlitFramebuffer");
+    LOAD_GL(PFNGLRENDERBUFFERSTORAGEPROC,      pglRenderbufferStorage,      "glRenderbufferStorage");
+    LOAD_GL(PFNGLRENDERBUFFERSTORAGEMULTISAMPLEPROC, pglRenderbufferStorageMultisample, "glRenderbufferStorageMultisample");
+    LOAD_GL(PFNGLBUFFERSUBDATAPROC,            pglBufferSubData,            "glBufferSubData");
+    LOAD_GL(PFNGLVERTEXATTRIBDIVISORPROC,      pglVertexAttribDivisor,      "glVertexAttribDivisor");
+    LOAD_GL(PFNGLDRAWARRAYSINSTANCEDPROC,      pglDrawArraysInstanced,      "glDrawArraysInstanced");
     *result = SUCCESS;
 }
 
@@ -1439,1873 +2390,6342 @@ unsigned char* get_framebuffer_rgb(CanimResult* result, int w, int h, unsigned c
     return rgb;
 }
 
+/// @def READBACK_STRIPE_BYTES
+/// @brief How big one readback stripe gets, at most. Two stripes are in
+/// play at a time, so this (times two) is the whole pbo footprint no
+/// matter how big the frame is.
+#define READBACK_STRIPE_BYTES (1 << 21)
+
 /**
- * @brief This opens ffmpeg pipe
- * @param w Width
- * @param h Height
- * @param fps frames per second
- * @param out_mp4 The output mp4
- * @return The file
+ * @brief Tiled, double-buffered pixel pack readback state
+ * @remark glReadPixels into client memory forces a full pipeline flush,
+ * and one giant pbo readback of a 4k frame stalls almost as badly at the
+ * map. So the frame comes back as horizontal stripes of bounded size
+ * through two ping-ponging GL_PIXEL_PACK_BUFFERs: while stripe N
+ * transfers, stripe N-1 is mapped and copied out. Peak latency and pbo
+ * memory stay flat as the resolution grows.
  */
 
-FILE* open_ffmpeg_pipe(int w, int h, int fps, const char* out_mp4) 
+typedef struct
 {
-    char cmd[1024];
-    snprintf(cmd, sizeof(cmd),
-        "ffmpeg -y -f rawvideo -pixel_format rgb24 -video_size %dx%d -framerate %d -i - "
-        "-vf vflip -c:v libx264 -preset veryfast -crf 18 -pix_fmt yuv420p \"%s\"",
-        w, h, fps, out_mp4);
-    
-    FILE* pipef = POPEN(cmd, WB);
-    if (!pipef)
-    {
-    	fprintf(stderr, "popen failed: %s (errno=%d)\n",strerror(errno),errno);
-    }
-    return pipef;
+    /**
+     *  @brief The two stripe-sized pixel pack buffers
+     *  */
+    GLuint pbo[2];
+    /**
+     *  @brief Which pbo receives the next stripe
+     *  */
+    int index;
+    /**
+     *  @brief Whether the other pbo holds a stripe in flight
+     *  */
+    bool pending_valid;
+    /**
+     *  @brief Which assembly buffer the in-flight stripe belongs to
+     *  */
+    int pending_buf;
+    /**
+     *  @brief Where in that buffer it lands
+     *  */
+    size_t pending_offset;
+    /**
+     *  @brief How big it is
+     *  */
+    size_t pending_bytes;
+    /**
+     *  @brief The two frame assembly buffers (one filling, one returned)
+     *  */
+    unsigned char* buf[2];
+    /**
+     *  @brief Which assembly buffer the in-flight frame fills
+     *  */
+    int fill;
+    /**
+     *  @brief Whether a frame is in flight at all yet
+     *  */
+    bool primed;
+    /**
+     *  @brief Frame width
+     *  */
+    int w;
+    /**
+     *  @brief Frame height
+     *  */
+    int h;
+    /**
+     *  @brief How many rows one stripe covers
+     *  */
+    int stripe_rows;
 }
+FramebufferReader;
 
 /**
- * @brief This closes ffmpeg pipe
- * @param pipef The pipe to close
+ * @brief Sets up the stripe pbos and the assembly buffers
+ * @param[out] result The status
+ * @param reader The reader
+ * @param w Frame width
+ * @param h Frame height
  * @return nothing
  */
 
-void close_ffmpeg_pipe(FILE* pipef) 
+void framebuffer_reader_init(CanimResult* result, FramebufferReader* reader, int w, int h)
 {
-    if (pipef) 
+    reader->index = 0;
+    reader->pending_valid = false;
+    reader->fill = 0;
+    reader->primed = false;
+    reader->w = w;
+    reader->h = h;
+    reader->stripe_rows = (int)(READBACK_STRIPE_BYTES / ((size_t)w * 3));
+    if (reader->stripe_rows < 1)
+    {
+        reader->stripe_rows = 1;
+    }
+    if (reader->stripe_rows > h)
+    {
+        reader->stripe_rows = h;
+    }
+    size_t frame_bytes = (size_t)w * h * 3;
+    size_t stripe_bytes = (size_t)reader->stripe_rows * w * 3;
+    reader->buf[0] = malloc(frame_bytes);
+    reader->buf[1] = malloc(frame_bytes);
+    if (!reader->buf[0] || !reader->buf[1])
+    {
+        free(reader->buf[0]);
+        free(reader->buf[1]);
+        reader->buf[0] = null;
+        reader->buf[1] = null;
+        *result = RGB_BUFFER_MALLOC_ERROR;
+        return;
+    }
+    pglGenBuffers(2, reader->pbo);
+    for (int i = 0; i < 2; i++)
     {
-        PCLOSE(pipef);
+        pglBindBuffer(GL_PIXEL_PACK_BUFFER, reader->pbo[i]);
+        pglBufferData(GL_PIXEL_PACK_BUFFER, stripe_bytes, null, GL_STREAM_READ);
     }
+    pglBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    *result = SUCCESS;
 }
 
 /**
- * @brief It outputs a brand new triangulation
- * @param[out] result The result is set to all the goofy errors.
- * @param src The triangulation to be cloned
- * @return The triangulation
+ * @brief Maps the in-flight stripe and copies it into its frame
+ * @param[out] result The status (NOOP when nothing is in flight)
+ * @param reader The reader
+ * @return nothing
+ * @remark A failed map drops the stripe instead of wedging the pipeline;
+ * the error still reaches the caller so the frame doesn't get encoded.
  */
 
-Triangulation* clone_triangulation(CanimResult* result, Triangulation* src)
+static void framebuffer_reader_retire(CanimResult* result, FramebufferReader* reader)
 {
-    Triangulation* tri = malloc(sizeof(Triangulation));
-    if (!tri)
-    {   
-        *result = TRI_CLONE_ERROR;
-        return null; 
+    if (!reader->pending_valid)
+    {
+        *result = NOOP;
+        return;
     }
-    tri->triangle_count = src->triangle_count;
-    tri->triangles = malloc(sizeof(TriangleRaw) * BIT_ALIGN(src->triangle_count));
-    if (!tri->triangles)
+    reader->pending_valid = false;
+    pglBindBuffer(GL_PIXEL_PACK_BUFFER, reader->pbo[1 - reader->index]);
+    void* mapped = pglMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+    if (!mapped)
     {
-        free(tri);
-        *result = TRI_CLONE_TRI_ERROR;
-        return null;
+        pglBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        *result = FRAMEBUFFER_READER_MAP_ERROR;
+        return;
     }
-    memcpy(tri->triangles, src->triangles, sizeof(TriangleRaw) * tri->triangle_count);
+    memcpy(reader->buf[reader->pending_buf] + reader->pending_offset, mapped, reader->pending_bytes);
+    pglUnmapBuffer(GL_PIXEL_PACK_BUFFER);
     *result = SUCCESS;
-    return tri;
-} 
+}
 
 /**
- * @brief It outputs an empty triangulations
- * @param[out] result The result is set to all the goofy errors.
- * @return The triangulation
+ * @brief Kicks off this frame's readback stripes and returns the previous frame
+ * @param[out] result The status (NOOP on the very first frame, when no
+ * previous frame exists yet)
+ * @param reader The reader
+ * @return The previous frame's pixels (owned by the reader, valid until
+ * the next grab), or null on the first frame
  */
 
-Triangulation* empty_triangulation(CanimResult* result)
+const unsigned char* framebuffer_reader_grab(CanimResult* result, FramebufferReader* reader)
 {
-    Triangulation* tri = malloc(sizeof(Triangulation));
-    if (!tri)
-    {   
-        *result = TRI_INIT_MALLOC_FAIL; // Soon that attitude will be your doom
-        return null; 
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    int returning = -1;
+    if (reader->primed)
+    {
+        // the frame in flight keeps filling its buffer; ours takes the other
+        returning = reader->fill;
+        reader->fill = 1 - reader->fill;
+    }
+    CanimResult stripe_result = SUCCESS;
+    for (int y = 0; y < reader->h; y += reader->stripe_rows)
+    {
+        int rows = reader->h - y < reader->stripe_rows ? reader->h - y : reader->stripe_rows;
+        // issue this stripe first, then drain the previous one while it transfers
+        pglBindBuffer(GL_PIXEL_PACK_BUFFER, reader->pbo[reader->index]);
+        glReadPixels(0, y, reader->w, rows, GL_RGB, GL_UNSIGNED_BYTE, (void*)0);
+        CanimResult r;
+        framebuffer_reader_retire(&r, reader);
+        if (IS_AN_ERROR(r))
+        {
+            stripe_result = r;
+        }
+        reader->pending_valid = true;
+        reader->pending_buf = reader->fill;
+        reader->pending_offset = (size_t)y * reader->w * 3;
+        reader->pending_bytes = (size_t)rows * reader->w * 3;
+        reader->index = 1 - reader->index;
     }
-    tri->triangle_count = 0;
-    tri->triangles = null;
-    *result = SUCCESS;
-    return tri;
-
-} 
-
-/**
- * @brief It adds a triangle to a triangulation
- * @param[out] result The result is set to all the goofy errors.
- * @param tri The triangulation that must have a new triangle appended to it
- * @param a The first vertex of the triangle
- * @param b The second vertex of the triangle
- * @param c The final vertex of the triangle 
- * @return Nothing
- */
-
-void add_triangle(CanimResult* result, Triangulation* tri, TriangleRaw triangle)
-{
-    if (!tri) 
+    pglBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    if (!reader->primed)
     {
-        *result = TRI_NOT_FOUND;
-        return;
+        reader->primed = true;
+        *result = NOOP;
+        return null;
     }
-
-    if (REALIGN(tri->triangle_count, tri->triangle_count + 1))
+    if (IS_AN_ERROR(stripe_result))
     {
-        int new_capacity = BIT_ALIGN(tri->triangle_count + 1); 
-        TriangleRaw* temp = realloc(tri->triangles, new_capacity * sizeof(TriangleRaw));
-        if (!temp)
-        {
-            *result = ADDING_TRI_REALLOC_FAILURE;
-            return;
-        }
-        tri->triangles = temp;
+        *result = stripe_result;
+        return null;
     }
-    memcpy(tri->triangles + tri->triangle_count, &triangle, sizeof(TriangleRaw));
-    tri->triangle_count++;
     *result = SUCCESS;
+    return reader->buf[returning];
 }
 
 /**
- * @brief It takes a collection of triangulations and merges them
- * @param[out] result The error code
- * @param triangulations The input triangulations
- * @param tri_count The number of triangulations
- * @param output A pointer to where the output will be stored
- * @return Nothing
+ * @brief Fetches the final in-flight frame after the render loop ends
+ * @param[out] result The status (NOOP if nothing was in flight)
+ * @param reader The reader
+ * @return The final frame's pixels (owned by the reader), or null
  */
 
-void merge_triangulations(CanimResult* result, Triangulation** triangulations, int tri_count, Triangulation* output)
+const unsigned char* framebuffer_reader_drain(CanimResult* result, FramebufferReader* reader)
 {
-    Triangulation* e = empty_triangulation(result);
-    if (e == null)
+    if (!reader->primed)
     {
-        *result = TRI_INIT_MALLOC_FAIL;
-        return;
+        *result = NOOP;
+        return null;
     }
-    output->triangle_count = e->triangle_count;
-    output->triangles = e->triangles;
-    /*
-        Note we use free instead of free_triangulation because
-        result->triangles points to the same memory as e->triangles and 
-        free_triangulation(e) would free e->triangles.
-    */
-    free(e);
-    
-    for (int i = 0; i < tri_count; i++)
+    framebuffer_reader_retire(result, reader);
+    reader->primed = false;
+    if (IS_AN_ERROR(*result))
     {
-        for (int j = 0; j < triangulations[i]->triangle_count; j++)
-        {
-            add_triangle(
-                result,
-                output, 
-                triangulations[i]->triangles[j]
-            );
-            if (IS_AN_ERROR(*result))
-            {
-                return;
-            }
-        }
+        return null;
     }
     *result = SUCCESS;
+    return reader->buf[reader->fill];
 }
 
 /**
- * @brief This function frees a triangulation object
- * @param[out] result This is always SUCCESS because freeing will always happen 
- * @param triangulation This is the triangulation to be freed
+ * @brief Deletes the pixel pack buffers and the assembly buffers
+ * @param reader The reader
  * @return nothing
  */
 
-void free_triangulation(Triangulation* triangulation)
+void framebuffer_reader_destroy(FramebufferReader* reader)
 {
-    free(triangulation->triangles);   
-    triangulation->triangles = null;
-    triangulation->triangle_count = 0;
-    free(triangulation);              
+    pglDeleteBuffers(2, reader->pbo);
+    reader->pbo[0] = 0;
+    reader->pbo[1] = 0;
+    free(reader->buf[0]);
+    free(reader->buf[1]);
+    reader->buf[0] = null;
+    reader->buf[1] = null;
+    reader->pending_valid = false;
+    reader->primed = false;
 }
 
 /**
- * @brief This adds two vectors and returns the result
- * @param a The first vector to be added
- * @param b The second vector to be added
- * @return This is the output of their summation
+ * @brief An offscreen render target: a multisampled FBO plus a plain one
+ * to resolve into before readback
+ * @remark Offline rendering never shows the window, so there is no reason
+ * to go through the default framebuffer, vsync, or SDL_GL_SwapWindow.
  */
 
-Vec3 add_vec3(Vec3 a, Vec3 b)
+typedef struct
 {
-    Vec3 result;
-    result.x = a.x + b.x;
-    result.y = a.y + b.y;
-    result.z = a.z + b.z;
-    return result;
+    /**
+     *  @brief The multisampled framebuffer everything renders into
+     *  */
+    GLuint msaa_fbo;
+    /**
+     *  @brief Its color renderbuffer
+     *  */
+    GLuint msaa_color;
+    /**
+     *  @brief Its depth renderbuffer
+     *  */
+    GLuint msaa_depth;
+    /**
+     *  @brief The single-sample framebuffer the msaa one resolves into
+     *  */
+    GLuint resolve_fbo;
+    /**
+     *  @brief Its color renderbuffer
+     *  */
+    GLuint resolve_color;
+    /**
+     *  @brief The width in pixels
+     *  */
+    int w;
+    /**
+     *  @brief The height in pixels
+     *  */
+    int h;
 }
+OffscreenTarget;
 
 /**
- * @brief This multiplies a vector by a scalar
- * @param a This is the vector
- * @param scalar This is a scalar
- * @return It returns the product of the vector and the scalar
+ * @brief Builds the offscreen target
+ * @param[out] result The status
+ * @param target The target
+ * @param w The width in pixels
+ * @param h The height in pixels
+ * @param samples How many msaa samples
+ * @return nothing
  */
 
-Vec3 multiply_vec3(Vec3 a, float scalar)
+void offscreen_target_init(CanimResult* result, OffscreenTarget* target, int w, int h, int samples)
 {
-    Vec3 result;
-    result.x = a.x * scalar;
-    result.y = a.y * scalar;
-    result.z = a.z * scalar;
-    return result;
+    target->w = w;
+    target->h = h;
+    pglGenFramebuffers(1, &target->msaa_fbo);
+    pglGenRenderbuffers(1, &target->msaa_color);
+    pglGenRenderbuffers(1, &target->msaa_depth);
+    pglBindRenderbuffer(GL_RENDERBUFFER, target->msaa_color);
+    pglRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_RGB8, w, h);
+    pglBindRenderbuffer(GL_RENDERBUFFER, target->msaa_depth);
+    pglRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_DEPTH_COMPONENT24, w, h);
+    pglBindFramebuffer(GL_FRAMEBUFFER, target->msaa_fbo);
+    pglFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, target->msaa_color);
+    pglFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, target->msaa_depth);
+    if (pglCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        *result = OFFSCREEN_TARGET_ERROR;
+        return;
+    }
+    pglGenFramebuffers(1, &target->resolve_fbo);
+    pglGenRenderbuffers(1, &target->resolve_color);
+    pglBindRenderbuffer(GL_RENDERBUFFER, target->resolve_color);
+    pglRenderbufferStorage(GL_RENDERBUFFER, GL_RGB8, w, h);
+    pglBindFramebuffer(GL_FRAMEBUFFER, target->resolve_fbo);
+    pglFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, target->resolve_color);
+    if (pglCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        *result = OFFSCREEN_TARGET_ERROR;
+        return;
+    }
+    // leave the msaa fbo bound, that is where the frames go
+    pglBindFramebuffer(GL_FRAMEBUFFER, target->msaa_fbo);
+    *result = SUCCESS;
 }
 
 /**
- * @brief This subtracts two vectors and returns the result
- * @param a The vector to be subtracteed from
- * @param b The vector to be subtracted
- * @return This is the output of their subtraction so @p a - @p b
+ * @brief Resolves the msaa frame and leaves it bound for reading
+ * @param target The target
+ * @return nothing
+ * @remark After this the pixel pack readback pulls from the resolve
+ * buffer; call again after rebinding msaa_fbo for the next frame.
  */
 
-Vec3 subtract_vec3(Vec3 a, Vec3 b)
+void offscreen_target_resolve(OffscreenTarget* target)
 {
-    return add_vec3(a, multiply_vec3(b, -1.0f));
+    pglBindFramebuffer(GL_READ_FRAMEBUFFER, target->msaa_fbo);
+    pglBindFramebuffer(GL_DRAW_FRAMEBUFFER, target->resolve_fbo);
+    pglBlitFramebuffer(0, 0, target->w, target->h, 0, 0, target->w, target->h, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    pglBindFramebuffer(GL_READ_FRAMEBUFFER, target->resolve_fbo);
 }
 
 /**
- * @brief This interpolates between two vectors
- * @param a This is the starting vector
- * @param b This is the ending vector
- * @param t This is how much we interpolate
- * @return It returns lerp( @p a, @p b, @p t )
+ * @brief Deletes the offscreen target's GL objects
+ * @param target The target
+ * @return nothing
  */
 
-Vec3 lerp_vec3(Vec3 a, Vec3 b, float t)
+void offscreen_target_destroy(OffscreenTarget* target)
 {
-    return add_vec3(a, multiply_vec3(subtract_vec3(b, a), t));
+    pglBindFramebuffer(GL_FRAMEBUFFER, 0);
+    pglDeleteFramebuffers(1, &target->msaa_fbo);
+    pglDeleteFramebuffers(1, &target->resolve_fbo);
+    pglDeleteRenderbuffers(1, &target->msaa_color);
+    pglDeleteRenderbuffers(1, &target->msaa_depth);
+    pglDeleteRenderbuffers(1, &target->resolve_color);
 }
 
 /**
- * @brief 
- * @param v The vector to be subtracteed from
- * @return This outputs the magnitude of v
+ * @brief This opens ffmpeg pipe
+ * @param w Width
+ * @param h Height
+ * @param fps frames per second
+ * @param out_mp4 The output mp4
+ * @return The file
  */
 
-float magnitude_vec3(Vec3 a)
+FILE* open_ffmpeg_pipe(int w, int h, int fps, const char* out_mp4) 
 {
-    return sqrt(a.x*a.x + a.y*a.y + a.z*a.z);
+    char cmd[1024];
+    snprintf(cmd, sizeof(cmd),
+        "ffmpeg -y -f rawvideo -pixel_format rgb24 -video_size %dx%d -framerate %d -i - "
+        "-vf vflip -c:v libx264 -preset veryfast -crf 18 -pix_fmt yuv420p \"%s\"",
+        w, h, fps, out_mp4);
+    
+    FILE* pipef = POPEN(cmd, WB);
+    if (!pipef)
+    {
+    	fprintf(stderr, "popen failed: %s (errno=%d)\n",strerror(errno),errno);
+    }
+    return pipef;
 }
 
 /**
- * @brief This is the distance between two points
- * @param a the first one
- * @param b The second one
- * @return The distance
+ * @brief This closes ffmpeg pipe
+ * @param pipef The pipe to close
+ * @return nothing
  */
 
-float dist_vec3(Vec3 a, Vec3 b)
+void close_ffmpeg_pipe(FILE* pipef)
 {
-    return magnitude_vec3(subtract_vec3(a, b));
-} 
+    if (pipef)
+    {
+        PCLOSE(pipef);
+    }
+}
+
+/// @def FFMPEG_RING_FRAMES
+/// @brief How many frames the async writer buffers before the render
+/// thread has to wait for the encoder.
+#define FFMPEG_RING_FRAMES 4
 
 /**
- * @brief This outputs whether or not two vectors are equal
- * @param a the first one
- * @param b The second one
- * @return a bool
+ * @brief An asynchronous ffmpeg pipe writer
+ * @remark The render thread drops frames into a small ring and keeps
+ * going; a dedicated thread feeds them to ffmpeg. Backpressure only
+ * kicks in when every ring slot is full.
  */
 
-bool equal_vec3(Vec3 a, Vec3 b)
+typedef struct
 {
-    return fabs(dist_vec3(a, b)) < EPSILON;
-} 
+    /**
+     *  @brief The underlying ffmpeg pipe
+     *  */
+    FILE* pipef;
+    /**
+     *  @brief The ring of frame buffers
+     *  */
+    unsigned char* frames[FFMPEG_RING_FRAMES];
+    /**
+     *  @brief The size of one frame in bytes
+     *  */
+    size_t frame_bytes;
+    /**
+     *  @brief The slot the writer thread reads next
+     *  */
+    int head;
+    /**
+     *  @brief How many slots are filled
+     *  */
+    int count;
+    /**
+     *  @brief Set when no more frames are coming
+     *  */
+    bool shutdown;
+    /**
+     *  @brief Set by the writer thread when fwrite to the pipe failed
+     *  */
+    bool write_failed;
+    /**
+     *  @brief Protects everything above
+     *  */
+    SDL_mutex* lock;
+    /**
+     *  @brief Signalled when a frame lands in the ring
+     *  */
+    SDL_cond* not_empty;
+    /**
+     *  @brief Signalled when a slot frees up
+     *  */
+    SDL_cond* not_full;
+    /**
+     *  @brief The writer thread itself
+     *  */
+    SDL_Thread* thread;
+}
+FFmpegWriter;
 
 /**
- * @brief This normalizes a vector
- * @param a The vector to be normalized
- * @return The normalization
+ * @brief The writer thread: drain the ring into the pipe until shutdown
+ * @param data The FFmpegWriter
+ * @return always 0, failures land in write_failed
  */
 
-Vec3 normalize_vec3(Vec3 a)
+static int ffmpeg_writer_thread(void* data)
 {
-    float mag = magnitude_vec3(a);
-    if (mag < EPSILON)
+    FFmpegWriter* writer = data;
+    for (;;)
     {
-        Vec3 f = {0, 0, 0};
-        return f;
+        SDL_LockMutex(writer->lock);
+        for (;writer->count == 0 && !writer->shutdown;)
+        {
+            SDL_CondWait(writer->not_empty, writer->lock);
+        }
+        if (writer->count == 0 && writer->shutdown)
+        {
+            SDL_UnlockMutex(writer->lock);
+            return 0;
+        }
+        unsigned char* frame = writer->frames[writer->head];
+        SDL_UnlockMutex(writer->lock);
+        // only this thread consumes, so the slot is safe to use unlocked
+        CANIM_PROF_BEGIN(CANIM_PROF_FFMPEG);
+        size_t wrote = fwrite(frame, 1, writer->frame_bytes, writer->pipef);
+        CANIM_PROF_END(CANIM_PROF_FFMPEG);
+        CANIM_PROF_ALLOC(CANIM_PROF_FFMPEG, writer->frame_bytes);
+        SDL_LockMutex(writer->lock);
+        if (wrote != writer->frame_bytes)
+        {
+            writer->write_failed = true;
+        }
+        writer->head = (writer->head + 1) % FFMPEG_RING_FRAMES;
+        writer->count--;
+        SDL_CondSignal(writer->not_full);
+        SDL_UnlockMutex(writer->lock);
     }
-    return multiply_vec3(a, 1 / mag);
 }
 
 /**
- * @brief This takes the cross product fo two vectors
- * @param a the first one
- * @param b the second one
- * @return the normalization
+ * @brief Opens an asynchronous ffmpeg writer
+ * @param[out] result The status
+ * @param w Width
+ * @param h Height
+ * @param fps frames per second
+ * @param out_mp4 The output mp4
+ * @return The writer, or null on failure
  */
 
-Vec3 cross_vec3(Vec3 a, Vec3 b)
+FFmpegWriter* open_ffmpeg_writer(CanimResult* result, int w, int h, int fps, const char* out_mp4)
 {
-    Vec3 r = 
+    FFmpegWriter* writer = calloc(1, sizeof(FFmpegWriter));
+    if (!writer)
     {
-        a.y * b.z - a.z * b.y,
-        a.z * b.x - a.x * b.z,
-        a.x * b.y - a.y * b.x
-    };
-    return r;
+        *result = FFMPEG_WRITER_MALLOC_ERROR;
+        return null;
+    }
+    writer->frame_bytes = (size_t)w * h * 3;
+    for (int i = 0; i < FFMPEG_RING_FRAMES; i++)
+    {
+        writer->frames[i] = malloc(writer->frame_bytes);
+        if (!writer->frames[i])
+        {
+            for (int j = 0; j < i; j++)
+            {
+                free(writer->frames[j]);
+            }
+            free(writer);
+            *result = FFMPEG_WRITER_MALLOC_ERROR;
+            return null;
+        }
+    }
+    writer->pipef = open_ffmpeg_pipe(w, h, fps, out_mp4);
+    writer->lock = SDL_CreateMutex();
+    writer->not_empty = SDL_CreateCond();
+    writer->not_full = SDL_CreateCond();
+    if (writer->pipef && writer->lock && writer->not_empty && writer->not_full)
+    {
+        writer->thread = SDL_CreateThread(ffmpeg_writer_thread, "canim_ffmpeg", writer);
+    }
+    if (!writer->thread)
+    {
+        if (writer->pipef)
+        {
+            close_ffmpeg_pipe(writer->pipef);
+        }
+        if (writer->lock)
+        {
+            SDL_DestroyMutex(writer->lock);
+        }
+        if (writer->not_empty)
+        {
+            SDL_DestroyCond(writer->not_empty);
+        }
+        if (writer->not_full)
+        {
+            SDL_DestroyCond(writer->not_full);
+        }
+        for (int i = 0; i < FFMPEG_RING_FRAMES; i++)
+        {
+            free(writer->frames[i]);
+        }
+        free(writer);
+        *result = FFMPEG_WRITER_THREAD_ERROR;
+        return null;
+    }
+    *result = SUCCESS;
+    return writer;
 }
 
 /**
- * @brief Generates normal vector 
- * @param a first vertex of the triangle
- * @param b The second vertex
- * @param c The third
- * @return A normal vector
+ * @brief Hands one rgb frame to the writer
+ * @param[out] result The status
+ * @param writer The writer
+ * @param rgb The frame (frame_bytes bytes, copied into the ring)
+ * @return nothing
+ * @remark Returns immediately unless the ring is full, in which case we
+ * wait for the encoder to catch up.
  */
 
-Vec3 normal_vec3(Vec3 a, Vec3 b, Vec3 c)
+void ffmpeg_writer_submit(CanimResult* result, FFmpegWriter* writer, const unsigned char* rgb)
 {
-    Vec3 AB = subtract_vec3(b, a);
-    Vec3 AC = subtract_vec3(c, a);
-    Vec3 n  = cross_vec3(AB, AC);   
-    return normalize_vec3(n);        
+    SDL_LockMutex(writer->lock);
+    for (;writer->count == FFMPEG_RING_FRAMES;)
+    {
+        SDL_CondWait(writer->not_full, writer->lock);
+    }
+    int slot = (writer->head + writer->count) % FFMPEG_RING_FRAMES;
+    memcpy(writer->frames[slot], rgb, writer->frame_bytes);
+    writer->count++;
+    SDL_CondSignal(writer->not_empty);
+    bool failed = writer->write_failed;
+    SDL_UnlockMutex(writer->lock);
+    *result = failed ? FFMPEG_WRITER_WRITE_ERROR : SUCCESS;
 }
 
 /**
- * @brief This multiplies two quaternions
- * @param q1 the first one 
- * @param q2 the second one
- * @return q1 * q2
+ * @brief Drains the ring, stops the thread, and closes the pipe
+ * @param[out] result The status (write failures surface here)
+ * @param writer The writer to close
+ * @return nothing
  */
 
-Quaternion quat_mul(Quaternion q1, Quaternion q2)
+void close_ffmpeg_writer(CanimResult* result, FFmpegWriter* writer)
 {
-    return (Quaternion) 
+    if (!writer)
     {
-        .x = q1.w*q2.x + q1.x*q2.w + q1.y*q2.z - q1.z*q2.y,
-        .y = q1.w*q2.y - q1.x*q2.z + q1.y*q2.w + q1.z*q2.x,
-        .z = q1.w*q2.z + q1.x*q2.y - q1.y*q2.x + q1.z*q2.w,
-        .w = q1.w*q2.w - q1.x*q2.x - q1.y*q2.y - q1.z*q2.z
-    };
+        *result = NOOP;
+        return;
+    }
+    SDL_LockMutex(writer->lock);
+    writer->shutdown = true;
+    SDL_CondSignal(writer->not_empty);
+    SDL_UnlockMutex(writer->lock);
+    SDL_WaitThread(writer->thread, null);
+    close_ffmpeg_pipe(writer->pipef);
+    *result = writer->write_failed ? FFMPEG_WRITER_WRITE_ERROR : SUCCESS;
+    SDL_DestroyMutex(writer->lock);
+    SDL_DestroyCond(writer->not_empty);
+    SDL_DestroyCond(writer->not_full);
+    for (int i = 0; i < FFMPEG_RING_FRAMES; i++)
+    {
+        free(writer->frames[i]);
+    }
+    free(writer);
 }
 
+/// @def MIX_FREQUENCY
+/// @brief The sample rate the offline mixdown runs at.
+#define MIX_FREQUENCY 44100
+
+/// @def MIX_OUTPUT_CHANNELS
+/// @brief Everything gets mixed down to interleaved stereo.
+#define MIX_OUTPUT_CHANNELS 2
+
 /**
- * @brief This conjugates a quaternion
- * @param q This is the quaternion
- * @return This returns the conjugate of the quaternion
+ * @brief One decoded sound in the cache
  */
 
-Quaternion quat_conjugate(Quaternion q) 
+typedef struct
 {
-    return (Quaternion)
-    {   
-        .x=-q.x, 
-        .y=-q.y, 
-        .z=-q.z, 
-        .w=q.w 
-    };
+    /**
+     * @brief The path the sound was loaded from
+     */
+    char* path;
+    /**
+     * @brief The decoded samples (s16 interleaved at the mixer spec)
+     */
+    Mix_Chunk* chunk;
 }
+SoundCacheEntry;
 
 /**
- * @brief This generates a quaternion from an angle/axis
- * @param axis This is the axis to rotate around
- * @param angle This is the angle of rotation
- * @return A quaternion
+ * @brief A cache of decoded sounds, so a sound that appears on five
+ * channels is decoded exactly once
  */
 
-Quaternion quat_from_axis_angle(Vec3 axis, float angle) 
+typedef struct
 {
-    axis = normalize_vec3(axis);
-    float half = angle * 0.5f;
-    float s = sinf(half);
-
-    return (Quaternion)
-    { 
-        .x=axis.x*s, 
-        .y=axis.y*s, 
-        .z=axis.z*s, 
-        .w=cosf(half) 
-    };
+    /**
+     * @brief The cached sounds
+     */
+    SoundCacheEntry* entries;
+    /**
+     * @brief How many are cached
+     */
+    int count;
+    /**
+     * @brief How many fit before a realloc
+     */
+    int capacity;
 }
+SoundCache;
 
 /**
- * @brief This uses a rotation quaternion to rotate a vector
- * @param q The quaternion
- * @param v The vector
- * @return The new rotated vec3.
+ * @brief Fetches a decoded sound from the cache, loading it on a miss
+ * @param[out] result The status
+ * @param cache The cache
+ * @param path The sound file
+ * @return The decoded chunk, or null on error
+ * @remark Loading is NOT thread safe (Mix_LoadWAV isn't), so the whole
+ * cache is warmed up single threaded before the mix workers start and
+ * every call they make is a pure lookup.
  */
 
-Vec3 quat_rotate_vec3(Quaternion q, Vec3 v) 
+Mix_Chunk* sound_cache_get(CanimResult* result, SoundCache* cache, const char* path)
 {
-    Quaternion vq = { 
-        .x=v.x, 
-        .y=v.y, 
-        .z=v.z, 
-        .w=0.0f 
-    };
-    Quaternion qi = quat_conjugate(q);
-    Quaternion r = quat_mul(quat_mul(q, vq), qi);
-    return (Vec3)
-    { 
-        r.x, 
-        r.y, 
-        r.z 
-    };
+    for (int i = 0; i < cache->count; i++)
+    {
+        if (strcmp(cache->entries[i].path, path) == 0)
+        {
+            *result = SUCCESS;
+            return cache->entries[i].chunk;
+        }
+    }
+    if (cache->count == cache->capacity)
+    {
+        int capacity = BIT_ALIGN(cache->count + 1);
+        SoundCacheEntry* entries = realloc(cache->entries, capacity * sizeof(SoundCacheEntry));
+        if (!entries)
+        {
+            *result = SOUND_MIX_MALLOC_ERROR;
+            return null;
+        }
+        cache->entries = entries;
+        cache->capacity = capacity;
+    }
+    Mix_Chunk* chunk = Mix_LoadWAV(path);
+    if (!chunk)
+    {
+        *result = SOUND_MIX_LOAD_ERROR;
+        return null;
+    }
+    char* copy = malloc(strlen(path) + 1);
+    if (!copy)
+    {
+        Mix_FreeChunk(chunk);
+        *result = SOUND_MIX_MALLOC_ERROR;
+        return null;
+    }
+    strcpy(copy, path);
+    cache->entries[cache->count].path = copy;
+    cache->entries[cache->count].chunk = chunk;
+    cache->count++;
+    *result = SUCCESS;
+    return chunk;
 }
 
 /**
- * @brief This generates a quaternion from an angle/axis
- * @param axis This is the axis to rotate around
- * @param angle This is the angle of rotation
- * @param vec This is the vector to be rotated
- * @return A vector
+ * @brief Frees every cached sound
+ * @param cache The cache
+ * @return nothing
  */
 
-Vec3 rotate_vector(Vec3 axis, float angle, Vec3 vec) 
+void free_sound_cache(SoundCache* cache)
 {
-    Quaternion q = quat_from_axis_angle(axis, angle);
-    return quat_rotate_vec3(q, vec);
+    for (int i = 0; i < cache->count; i++)
+    {
+        free(cache->entries[i].path);
+        Mix_FreeChunk(cache->entries[i].chunk);
+    }
+    free(cache->entries);
+    cache->entries = null;
+    cache->count = 0;
+    cache->capacity = 0;
 }
 
 /**
- * @brief This checks if two segments are intersecting
- * @param a This parameter is the first vertex of the first edge
- * @param b This parameter is the second vertex of the first edge
- * @param c This parameter is the first vertex of the second edge
- * @param d This parameter is the second vertex of the second edge.
- * @param[out] out If the edges intersect, this outputs where they intersect.
- * @return This outputs 1 if they intersect but 0 if they don't
+ * @brief Accumulates s16 samples into a float buffer
+ * @param[out] dst The float accumulator
+ * @param src The s16 samples to add in
+ * @param n The number of samples
+ * @return nothing
+ * @remark Mixing in floats means overlapping sounds can't wrap around
+ * the s16 range mid-mix; the clamp happens once at the very end.
  */
 
-int intersecting_segments(Vec3 a, Vec3 b, Vec3 c, Vec3 d, Vec3* out)
-{    
-    if (
-        fabs(a.x-b.x) < EPSILON && 
-        fabs(a.y-b.y) < EPSILON && 
-        fabs(c.x-d.x) < EPSILON && 
-        fabs(c.y-d.y) < EPSILON 
-    )
-    {
-        return 0;
-    }
-    float tx; 
-    float ty;
-    int vertical = 0;
-    float denomx;
-    float denomy;
-    if (
-        fabs(a.x-b.x) < EPSILON && 
-        fabs(a.y-b.y) < EPSILON 
-    )
-    {
-        tx = (a.x - c.x);
-        ty = (a.y - c.y);
-        denomx = d.x - c.x;
-        denomy = d.y - c.y;
-        vertical = 1;
+static void mix_accumulate_s16(float* dst, const int16_t* src, size_t n)
+{
+    size_t i = 0;
+#if defined(__SSE2__)
+    // eight samples per iteration: sign-extend to s32, convert, add
+    for (; i + 8 <= n; i += 8)
+    {
+        __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128 lo = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16));
+        __m128 hi = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16));
+        _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), lo));
+        _mm_storeu_ps(dst + i + 4, _mm_add_ps(_mm_loadu_ps(dst + i + 4), hi));
+    }
+#elif defined(__ARM_NEON)
+    for (; i + 8 <= n; i += 8)
+    {
+        int16x8_t s = vld1q_s16(src + i);
+        float32x4_t lo = vcvtq_f32_s32(vmovl_s16(vget_low_s16(s)));
+        float32x4_t hi = vcvtq_f32_s32(vmovl_s16(vget_high_s16(s)));
+        vst1q_f32(dst + i, vaddq_f32(vld1q_f32(dst + i), lo));
+        vst1q_f32(dst + i + 4, vaddq_f32(vld1q_f32(dst + i + 4), hi));
     }
-    if (
-        fabs(c.x - d.x) < EPSILON &&
-        fabs(c.y - d.y) < EPSILON
-    )   
+#endif
+    for (; i < n; i++)
     {
-        tx = (c.x - a.x);
-        ty = (c.y - a.y);
-        denomx = b.x - a.x;
-        denomy = b.x - a.y; // if you change this line of code, i will end you
-        vertical = 2;
+        dst[i] += src[i];
     }
-    if (vertical > 0)
+}
+
+/**
+ * @brief Mixes every sound of one channel into its float buffer
+ * @param sd The sound data
+ * @param cache The (already warmed up) sound cache
+ * @param channel Which channel to mix
+ * @param[out] dst The channel's float buffer
+ * @param samples How many samples the buffer holds
+ * @return nothing
+ */
+
+static void mix_channel(SoundData* sd, SoundCache* cache, int channel, float* dst, size_t samples)
+{
+    for (int s = 0; s < sd->sound_count[channel]; s++)
     {
-        if (fabs(denomx) < EPSILON)
-        {
-            return 0;
-        }
-        if (fabs(denomy) < EPSILON)
-        {
-            return 0;
-        }
-        
-        tx /= denomx;
-        ty /= denomy;
-        if (tx < 0 || tx > 1)
-        {
-            return 0;
-        }
-        if (ty < 0 || ty > 1)
+        CanimResult lookup = SUCCESS;
+        Mix_Chunk* chunk = sound_cache_get(&lookup, cache, sd->sounds[channel][s]);
+        if (!chunk)
         {
-            return 0;
+            // can't happen after the warmup, but don't crash if it does
+            continue;
         }
-        
-        float t_avg;
-        if (fabs(tx - ty) < EPSILON)
+        float at = sd->start_t[channel][s];
+        if (at < 0)
         {
-            t_avg = (tx + ty) / 2;
+            at = 0;
         }
-        else
+        size_t start = (size_t)(at * MIX_FREQUENCY) * MIX_OUTPUT_CHANNELS;
+        size_t length = chunk->alen / sizeof(int16_t);
+        float window = sd->end_t[channel][s] - at;
+        if (window > 0)
         {
-            return 0;
+            size_t clip = (size_t)(window * MIX_FREQUENCY) * MIX_OUTPUT_CHANNELS;
+            if (clip < length)
+            {
+                length = clip;
+            }
         }
-        if (vertical == 1)
+        if (start >= samples)
         {
-            *out = lerp_vec3(c, d, t_avg);
+            continue;
         }
-        else if (vertical == 2)
+        if (length > samples - start)
         {
-            *out = lerp_vec3(a, b, t_avg);
+            length = samples - start;
         }
-        return 1;
+        mix_accumulate_s16(dst + start, (const int16_t*)chunk->abuf, length);
     }
-    float denom = (a.x - b.x)*(c.y - d.y) - (a.y - b.y)*(c.x - d.x);
+}
 
-    if (fabs(denom) < EPSILON)
-    {
-        return 0;
+/**
+ * @brief Shared state for the channel mixing worker pool
+ */
+
+typedef struct
+{
+    /**
+     *  @brief The sound data being mixed
+     *  */
+    SoundData* sd;
+    /**
+     *  @brief The warmed up sound cache (read only from here on)
+     *  */
+    SoundCache* cache;
+    /**
+     *  @brief The per-channel float buffers
+     *  */
+    float** channels;
+    /**
+     *  @brief How many samples each buffer holds
+     *  */
+    size_t samples;
+    /**
+     *  @brief The next channel nobody has claimed yet
+     *  */
+    SDL_atomic_t next_channel;
+}
+SoundMixJob;
+
+/**
+ * @brief Worker loop: claim channels until there are none left
+ * @param data The SoundMixJob
+ * @return always 0
+ * @remark Unlike the triangulation workers there is no stop flag:
+ * mixing a channel can't fail once the cache is warm.
+ */
+
+static int sound_mix_worker(void* data)
+{
+    SoundMixJob* job = data;
+    for (;;)
+    {
+        int c = SDL_AtomicAdd(&job->next_channel, 1);
+        if (c >= job->sd->channel_count)
+        {
+            break;
+        }
+        mix_channel(job->sd, job->cache, c, job->channels[c], job->samples);
+    }
+    return 0;
+}
+
+/**
+ * @brief Mixes all channels of a SoundData down to interleaved stereo s16
+ * @param[out] result The status
+ * @param sd The sound data
+ * @param[out] out_samples How many samples came out
+ * @return The mixdown (caller frees), or null on error
+ * @remark Channels are mixed concurrently, one worker per channel (capped
+ * by the core count); the calling thread joins the pool too, so a failed
+ * thread spawn just means less parallelism. The caller must have opened
+ * the mixer already so the chunks decode to the mixdown spec.
+ */
+
+int16_t* mixdown_sound_data(CanimResult* result, SoundData* sd, size_t* out_samples)
+{
+    if (sd->channel_count <= 0)
+    {
+        *result = NOOP;
+        return null;
+    }
+    // warm the cache single threaded, and learn the total length while at it
+    SoundCache cache = { null, 0, 0 };
+    float end = 0;
+    for (int c = 0; c < sd->channel_count; c++)
+    {
+        for (int s = 0; s < sd->sound_count[c]; s++)
+        {
+            Mix_Chunk* chunk = sound_cache_get(result, &cache, sd->sounds[c][s]);
+            if (IS_AN_ERROR(*result))
+            {
+                free_sound_cache(&cache);
+                return null;
+            }
+            float frames = (float)(chunk->alen / sizeof(int16_t) / MIX_OUTPUT_CHANNELS);
+            float chunk_end = sd->start_t[c][s] + frames / MIX_FREQUENCY;
+            float stop = sd->end_t[c][s];
+            if (stop <= sd->start_t[c][s] || stop > chunk_end)
+            {
+                stop = chunk_end;
+            }
+            if (stop > end)
+            {
+                end = stop;
+            }
+        }
+    }
+    size_t samples = ((size_t)(end * MIX_FREQUENCY) + 1) * MIX_OUTPUT_CHANNELS;
+
+    float** channels = malloc(sd->channel_count * sizeof(float*));
+    if (!channels)
+    {
+        free_sound_cache(&cache);
+        *result = SOUND_MIX_MALLOC_ERROR;
+        return null;
+    }
+    for (int c = 0; c < sd->channel_count; c++)
+    {
+        channels[c] = calloc(samples, sizeof(float));
+        if (!channels[c])
+        {
+            for (int k = 0; k < c; k++)
+            {
+                free(channels[k]);
+            }
+            free(channels);
+            free_sound_cache(&cache);
+            *result = SOUND_MIX_MALLOC_ERROR;
+            return null;
+        }
+    }
+
+    SoundMixJob job;
+    job.sd = sd;
+    job.cache = &cache;
+    job.channels = channels;
+    job.samples = samples;
+    SDL_AtomicSet(&job.next_channel, 0);
+
+    int nworkers = SDL_GetCPUCount();
+    if (nworkers > sd->channel_count)
+    {
+        nworkers = sd->channel_count;
+    }
+    if (nworkers < 1)
+    {
+        nworkers = 1;
+    }
+    // the calling thread is worker zero, so spawn one fewer
+    SDL_Thread** threads = null;
+    int spawned = 0;
+    if (nworkers > 1)
+    {
+        threads = malloc((nworkers - 1) * sizeof(SDL_Thread*));
+        if (threads)
+        {
+            for (int i = 0; i < nworkers - 1; i++)
+            {
+                threads[spawned] = SDL_CreateThread(sound_mix_worker, "canim_mix", &job);
+                if (threads[spawned])
+                {
+                    spawned++;
+                }
+            }
+        }
+    }
+    sound_mix_worker(&job);
+    for (int i = 0; i < spawned; i++)
+    {
+        SDL_WaitThread(threads[i], null);
+    }
+    free(threads);
+    free_sound_cache(&cache);
+
+    // sum the channels into channel zero, then clamp down to s16
+    for (int c = 1; c < sd->channel_count; c++)
+    {
+        float* sum = channels[0];
+        float* src = channels[c];
+        for (size_t i = 0; i < samples; i++)
+        {
+            sum[i] += src[i];
+        }
+    }
+    int16_t* pcm = malloc(samples * sizeof(int16_t));
+    if (!pcm)
+    {
+        for (int c = 0; c < sd->channel_count; c++)
+        {
+            free(channels[c]);
+        }
+        free(channels);
+        *result = SOUND_MIX_MALLOC_ERROR;
+        return null;
+    }
+    for (size_t i = 0; i < samples; i++)
+    {
+        float v = channels[0][i];
+        if (v > 32767.0f)
+        {
+            v = 32767.0f;
+        }
+        if (v < -32768.0f)
+        {
+            v = -32768.0f;
+        }
+        pcm[i] = (int16_t)v;
+    }
+    for (int c = 0; c < sd->channel_count; c++)
+    {
+        free(channels[c]);
+    }
+    free(channels);
+    *out_samples = samples;
+    *result = SUCCESS;
+    return pcm;
+}
+
+/**
+ * @brief Streams a mixdown into ffmpeg as an audio file
+ * @param[out] result The status
+ * @param pcm The interleaved stereo s16 samples
+ * @param samples How many samples there are
+ * @param out_file The output audio file
+ * @return nothing
+ */
+
+void write_mixdown_to_ffmpeg(CanimResult* result, const int16_t* pcm, size_t samples, const char* out_file)
+{
+    char cmd[1024];
+    snprintf(cmd, sizeof(cmd),
+        "ffmpeg -y -f s16le -ar %d -ac %d -i - \"%s\"",
+        MIX_FREQUENCY, MIX_OUTPUT_CHANNELS, out_file);
+    FILE* pipef = POPEN(cmd, WB);
+    if (!pipef)
+    {
+        fprintf(stderr, "popen failed: %s (errno=%d)\n", strerror(errno), errno);
+        *result = SOUND_MIX_WRITE_ERROR;
+        return;
+    }
+    size_t written = fwrite(pcm, sizeof(int16_t), samples, pipef);
+    PCLOSE(pipef);
+    *result = written == samples ? SUCCESS : SOUND_MIX_WRITE_ERROR;
+}
+
+/**
+ * @brief Mixes a SoundData and writes the result next to the video
+ * @param[out] result The status
+ * @param sd The sound data
+ * @param out_file The output audio file
+ * @return nothing
+ * @remark Opens and closes the mixer itself, so the chunks decode
+ * straight to the mixdown spec.
+ */
+
+void write_sound_data(CanimResult* result, SoundData* sd, const char* out_file)
+{
+    if (Mix_OpenAudio(MIX_FREQUENCY, AUDIO_S16SYS, MIX_OUTPUT_CHANNELS, 1024) != 0)
+    {
+        *result = SOUND_MIX_LOAD_ERROR;
+        return;
+    }
+    size_t samples = 0;
+    int16_t* pcm = mixdown_sound_data(result, sd, &samples);
+    Mix_CloseAudio();
+    if (!pcm)
+    {
+        return;
+    }
+    write_mixdown_to_ffmpeg(result, pcm, samples, out_file);
+    free(pcm);
+}
+
+/**
+ * @brief It outputs a brand new triangulation
+ * @param[out] result The result is set to all the goofy errors.
+ * @param src The triangulation to be cloned
+ * @return The triangulation
+ */
+
+Triangulation* clone_triangulation(CanimResult* result, Triangulation* src)
+{
+    Triangulation* tri = malloc(sizeof(Triangulation));
+    if (!tri)
+    {   
+        *result = TRI_CLONE_ERROR;
+        return null; 
+    }
+    tri->triangle_count = src->triangle_count;
+    tri->triangle_capacity = BIT_ALIGN(src->triangle_count);
+    tri->gpu = (TriangulationGPU){0}; // the clone owns no GPU buffers
+    tri->triangles = malloc(sizeof(TriangleRaw) * BIT_ALIGN(src->triangle_count));
+    if (!tri->triangles)
+    {
+        free(tri);
+        *result = TRI_CLONE_TRI_ERROR;
+        return null;
+    }
+    memcpy(tri->triangles, src->triangles, sizeof(TriangleRaw) * tri->triangle_count);
+    *result = SUCCESS;
+    return tri;
+} 
+
+/**
+ * @brief It outputs an empty triangulations
+ * @param[out] result The result is set to all the goofy errors.
+ * @return The triangulation
+ */
+
+Triangulation* empty_triangulation(CanimResult* result)
+{
+    Triangulation* tri = malloc(sizeof(Triangulation));
+    if (!tri)
+    {   
+        *result = TRI_INIT_MALLOC_FAIL; // Soon that attitude will be your doom
+        return null; 
+    }
+    tri->triangle_count = 0;
+    tri->triangle_capacity = 0;
+    tri->triangles = null;
+    tri->gpu = (TriangulationGPU){0};
+    *result = SUCCESS;
+    return tri;
+
+}
+
+/**
+ * @brief It makes sure a triangulation can hold at least n triangles
+ * @param[out] result The result is set to all the goofy errors.
+ * @param tri The triangulation that wants more room
+ * @param n The number of triangles it must be able to hold
+ * @return Nothing
+ * @remark Callers that know how many triangles are coming (like
+ * merge_triangulations) should call this once up front so the whole batch
+ * costs a single allocation.
+ */
+
+void reserve_triangulation(CanimResult* result, Triangulation* tri, int n)
+{
+    if (!tri)
+    {
+        *result = TRI_NOT_FOUND;
+        return;
+    }
+    if (n <= tri->triangle_capacity)
+    {
+        *result = NOOP;
+        return;
+    }
+    int new_capacity = BIT_ALIGN(n);
+    TriangleRaw* temp = realloc(tri->triangles, new_capacity * sizeof(TriangleRaw));
+    if (!temp)
+    {
+        *result = TRI_RESERVE_REALLOC_ERROR;
+        return;
+    }
+    tri->triangles = temp;
+    tri->triangle_capacity = new_capacity;
+    *result = SUCCESS;
+}
+
+/**
+ * @brief It adds a triangle to a triangulation
+ * @param[out] result The result is set to all the goofy errors.
+ * @param tri The triangulation that must have a new triangle appended to it
+ * @param a The first vertex of the triangle
+ * @param b The second vertex of the triangle
+ * @param c The final vertex of the triangle 
+ * @return Nothing
+ */
+
+void add_triangle(CanimResult* result, Triangulation* tri, TriangleRaw triangle)
+{
+    if (!tri)
+    {
+        *result = TRI_NOT_FOUND;
+        return;
+    }
+
+    if (tri->triangle_count + 1 > tri->triangle_capacity)
+    {
+        /*
+            Double instead of stepping bucket by bucket, so appending n
+            triangles costs O(n) copied memory total, not O(n^2).
+        */
+        int new_capacity = max(tri->triangle_capacity * 2, BIT_ALIGN(tri->triangle_count + 1));
+        TriangleRaw* temp = realloc(tri->triangles, new_capacity * sizeof(TriangleRaw));
+        if (!temp)
+        {
+            *result = ADDING_TRI_REALLOC_FAILURE;
+            return;
+        }
+        tri->triangles = temp;
+        tri->triangle_capacity = new_capacity;
+    }
+    memcpy(tri->triangles + tri->triangle_count, &triangle, sizeof(TriangleRaw));
+    tri->triangle_count++;
+    tri->gpu.uploaded = false; // the vbo (if any) is now stale
+    *result = SUCCESS;
+}
+
+/**
+ * @brief Makes an empty struct-of-arrays triangulation
+ * @param[out] result The result
+ * @return The fresh triangulation
+ */
+
+TriangulationSoA* empty_soa_triangulation(CanimResult* result)
+{
+    TriangulationSoA* tri = malloc(sizeof(TriangulationSoA));
+    if (!tri)
+    {
+        *result = SOA_TRIANGULATION_MALLOC_ERROR;
+        return null;
+    }
+    tri->positions = null;
+    tri->normals = null;
+    tri->colors = null;
+    tri->triangle_count = 0;
+    tri->triangle_capacity = 0;
+    tri->gpu = (TriangulationGPU){0};
+    *result = SUCCESS;
+    return tri;
+}
+
+/**
+ * @brief Makes sure an SoA triangulation can hold at least n triangles
+ * @param[out] result The result
+ * @param tri The triangulation that wants more room
+ * @param n The number of triangles it must be able to hold
+ * @return nothing
+ */
+
+void reserve_soa_triangulation(CanimResult* result, TriangulationSoA* tri, int n)
+{
+    if (!tri)
+    {
+        *result = TRI_NOT_FOUND;
+        return;
+    }
+    if (n <= tri->triangle_capacity)
+    {
+        *result = NOOP;
+        return;
+    }
+    int new_capacity = BIT_ALIGN(n);
+    Vec3* positions = realloc(tri->positions, new_capacity * 3 * sizeof(Vec3));
+    if (!positions)
+    {
+        *result = SOA_TRIANGULATION_MALLOC_ERROR;
+        return;
+    }
+    tri->positions = positions;
+    Vec3* normals = realloc(tri->normals, new_capacity * sizeof(Vec3));
+    if (!normals)
+    {
+        *result = SOA_TRIANGULATION_MALLOC_ERROR;
+        return;
+    }
+    tri->normals = normals;
+    Color* colors = realloc(tri->colors, new_capacity * sizeof(Color));
+    if (!colors)
+    {
+        *result = SOA_TRIANGULATION_MALLOC_ERROR;
+        return;
+    }
+    tri->colors = colors;
+    tri->triangle_capacity = new_capacity;
+    *result = SUCCESS;
+}
+
+/**
+ * @brief Appends a triangle to an SoA triangulation
+ * @param[out] result The result
+ * @param tri The triangulation
+ * @param triangle The triangle (in the usual raw form)
+ * @return nothing
+ */
+
+void add_soa_triangle(CanimResult* result, TriangulationSoA* tri, TriangleRaw triangle)
+{
+    if (!tri)
+    {
+        *result = TRI_NOT_FOUND;
+        return;
+    }
+    if (tri->triangle_count + 1 > tri->triangle_capacity)
+    {
+        int n = max(tri->triangle_capacity * 2, BIT_ALIGN(tri->triangle_count + 1));
+        reserve_soa_triangulation(result, tri, n);
+        if (IS_AN_ERROR(*result))
+        {
+            return;
+        }
+    }
+    int i = tri->triangle_count;
+    tri->positions[i * 3 + 0] = triangle.vertices[0];
+    tri->positions[i * 3 + 1] = triangle.vertices[1];
+    tri->positions[i * 3 + 2] = triangle.vertices[2];
+    tri->normals[i] = triangle.fd.normal;
+    tri->colors[i] = triangle.fd.color;
+    tri->triangle_count++;
+    tri->gpu.uploaded = false; // the vbo (if any) is now stale
+    *result = SUCCESS;
+}
+
+/**
+ * @brief Converts an interleaved triangulation to struct-of-arrays form
+ * @param[out] result The result
+ * @param src The interleaved triangulation
+ * @return The SoA triangulation
+ */
+
+TriangulationSoA* soa_from_triangulation(CanimResult* result, Triangulation* src)
+{
+    TriangulationSoA* tri = empty_soa_triangulation(result);
+    if (IS_AN_ERROR(*result))
+    {
+        return null;
+    }
+    reserve_soa_triangulation(result, tri, src->triangle_count);
+    if (IS_AN_ERROR(*result))
+    {
+        free(tri->positions);
+        free(tri->normals);
+        free(tri->colors);
+        free(tri);
+        return null;
+    }
+    for (int i = 0; i < src->triangle_count; i++)
+    {
+        tri->positions[i * 3 + 0] = src->triangles[i].vertices[0];
+        tri->positions[i * 3 + 1] = src->triangles[i].vertices[1];
+        tri->positions[i * 3 + 2] = src->triangles[i].vertices[2];
+        tri->normals[i] = src->triangles[i].fd.normal;
+        tri->colors[i] = src->triangles[i].fd.color;
+    }
+    tri->triangle_count = src->triangle_count;
+    *result = SUCCESS;
+    return tri;
+}
+
+/**
+ * @brief It takes a collection of triangulations and merges them
+ * @param[out] result The error code
+ * @param triangulations The input triangulations
+ * @param tri_count The number of triangulations
+ * @param output A pointer to where the output will be stored
+ * @return Nothing
+ */
+
+void merge_triangulations(CanimResult* result, Triangulation** triangulations, int tri_count, Triangulation* output)
+{
+    Triangulation* e = empty_triangulation(result);
+    if (e == null)
+    {
+        *result = TRI_INIT_MALLOC_FAIL;
+        return;
+    }
+    output->triangle_count = e->triangle_count;
+    output->triangle_capacity = e->triangle_capacity;
+    output->triangles = e->triangles;
+    output->gpu = e->gpu;
+    /*
+        Note we use free instead of free_triangulation because
+        result->triangles points to the same memory as e->triangles and
+        free_triangulation(e) would free e->triangles.
+    */
+    free(e);
+
+    int total = 0;
+    for (int i = 0; i < tri_count; i++)
+    {
+        total += triangulations[i]->triangle_count;
+    }
+    reserve_triangulation(result, output, total);
+    if (IS_AN_ERROR(*result))
+    {
+        return;
+    }
+
+    for (int i = 0; i < tri_count; i++)
+    {
+        for (int j = 0; j < triangulations[i]->triangle_count; j++)
+        {
+            add_triangle(
+                result,
+                output, 
+                triangulations[i]->triangles[j]
+            );
+            if (IS_AN_ERROR(*result))
+            {
+                return;
+            }
+        }
+    }
+    *result = SUCCESS;
+}
+
+/**
+ * @brief This function frees a triangulation object
+ * @param[out] result This is always SUCCESS because freeing will always happen 
+ * @param triangulation This is the triangulation to be freed
+ * @return nothing
+ */
+
+void free_triangulation(Triangulation* triangulation)
+{
+    /*
+        Only triangulations that were actually drawn own GPU handles, and by
+        then the gl function pointers are loaded, so this is safe.
+    */
+    if (triangulation->gpu.vbo)
+    {
+        pglDeleteBuffers(1, &triangulation->gpu.vbo);
+    }
+    if (triangulation->gpu.instance_vbo)
+    {
+        pglDeleteBuffers(1, &triangulation->gpu.instance_vbo);
+    }
+    if (triangulation->gpu.vao)
+    {
+        pglDeleteVertexArrays(1, &triangulation->gpu.vao);
+    }
+    triangulation->gpu = (TriangulationGPU){0};
+    free(triangulation->triangles);
+    triangulation->triangles = null;
+    triangulation->triangle_count = 0;
+    triangulation->triangle_capacity = 0;
+    free(triangulation);
+}
+
+/**
+ * @brief This frees an SoA triangulation
+ * @param tri The triangulation to be freed
+ * @return nothing
+ */
+
+void free_soa_triangulation(TriangulationSoA* tri)
+{
+    if (!tri)
+    {
+        return;
+    }
+    if (tri->gpu.vbo)
+    {
+        pglDeleteBuffers(1, &tri->gpu.vbo);
+    }
+    if (tri->gpu.vao)
+    {
+        pglDeleteVertexArrays(1, &tri->gpu.vao);
+    }
+    free(tri->positions);
+    free(tri->normals);
+    free(tri->colors);
+    free(tri);
+}
+
+/**
+ * @brief This adds two vectors and returns the result
+ * @param a The first vector to be added
+ * @param b The second vector to be added
+ * @return This is the output of their summation
+ */
+
+Vec3 add_vec3(Vec3 a, Vec3 b)
+{
+    Vec3 result;
+    result.x = a.x + b.x;
+    result.y = a.y + b.y;
+    result.z = a.z + b.z;
+    return result;
+}
+
+/**
+ * @brief This multiplies a vector by a scalar
+ * @param a This is the vector
+ * @param scalar This is a scalar
+ * @return It returns the product of the vector and the scalar
+ */
+
+Vec3 multiply_vec3(Vec3 a, float scalar)
+{
+    Vec3 result;
+    result.x = a.x * scalar;
+    result.y = a.y * scalar;
+    result.z = a.z * scalar;
+    return result;
+}
+
+/**
+ * @brief This subtracts two vectors and returns the result
+ * @param a The vector to be subtracteed from
+ * @param b The vector to be subtracted
+ * @return This is the output of their subtraction so @p a - @p b
+ */
+
+Vec3 subtract_vec3(Vec3 a, Vec3 b)
+{
+    return add_vec3(a, multiply_vec3(b, -1.0f));
+}
+
+/**
+ * @brief This interpolates between two vectors
+ * @param a This is the starting vector
+ * @param b This is the ending vector
+ * @param t This is how much we interpolate
+ * @return It returns lerp( @p a, @p b, @p t )
+ */
+
+Vec3 lerp_vec3(Vec3 a, Vec3 b, float t)
+{
+    return add_vec3(a, multiply_vec3(subtract_vec3(b, a), t));
+}
+
+/**
+ * @brief 
+ * @param v The vector to be subtracteed from
+ * @return This outputs the magnitude of v
+ */
+
+float magnitude_vec3(Vec3 a)
+{
+    return sqrt(a.x*a.x + a.y*a.y + a.z*a.z);
+}
+
+/**
+ * @brief This is the distance between two points
+ * @param a the first one
+ * @param b The second one
+ * @return The distance
+ */
+
+float dist_vec3(Vec3 a, Vec3 b)
+{
+    return magnitude_vec3(subtract_vec3(a, b));
+} 
+
+/**
+ * @brief This outputs whether or not two vectors are equal
+ * @param a the first one
+ * @param b The second one
+ * @return a bool
+ */
+
+bool equal_vec3(Vec3 a, Vec3 b)
+{
+    return fabs(dist_vec3(a, b)) < EPSILON;
+} 
+
+/**
+ * @brief This normalizes a vector
+ * @param a The vector to be normalized
+ * @return The normalization
+ */
+
+Vec3 normalize_vec3(Vec3 a)
+{
+    float mag = magnitude_vec3(a);
+    if (mag < EPSILON)
+    {
+        Vec3 f = {0, 0, 0};
+        return f;
+    }
+    return multiply_vec3(a, 1 / mag);
+}
+
+/**
+ * @brief This takes the cross product fo two vectors
+ * @param a the first one
+ * @param b the second one
+ * @return the normalization
+ */
+
+Vec3 cross_vec3(Vec3 a, Vec3 b)
+{
+    Vec3 r = 
+    {
+        a.y * b.z - a.z * b.y,
+        a.z * b.x - a.x * b.z,
+        a.x * b.y - a.y * b.x
+    };
+    return r;
+}
+
+/**
+ * @brief Generates normal vector 
+ * @param a first vertex of the triangle
+ * @param b The second vertex
+ * @param c The third
+ * @return A normal vector
+ */
+
+Vec3 normal_vec3(Vec3 a, Vec3 b, Vec3 c)
+{
+    Vec3 AB = subtract_vec3(b, a);
+    Vec3 AC = subtract_vec3(c, a);
+    Vec3 n  = cross_vec3(AB, AC);
+    return normalize_vec3(n);
+}
+
+/*
+    The batch kernels below work on contiguous Vec3 arrays so the hot
+    loops (normals for a whole mesh, morph lerps, ...) stop bouncing
+    through the single-vector helpers one call per vertex. The SIMD
+    paths are SSE2 and NEON; everything falls back to plain scalar code.
+*/
+
+/**
+ * @brief Adds two contiguous Vec3 arrays elementwise
+ * @param[out] out Where the sums go (may alias a or b)
+ * @param a The first array
+ * @param b The second array
+ * @param n The number of vectors
+ * @return nothing
+ */
+
+void vec3_add_n(Vec3* out, const Vec3* a, const Vec3* b, int n)
+{
+    // elementwise over the flat float view, the Vec3 boundaries don't matter
+    const float* fa = (const float*)a;
+    const float* fb = (const float*)b;
+    float* fo = (float*)out;
+    int total = n * 3;
+    int i = 0;
+#if defined(__SSE2__)
+    for (; i + 4 <= total; i += 4)
+    {
+        _mm_storeu_ps(fo + i, _mm_add_ps(_mm_loadu_ps(fa + i), _mm_loadu_ps(fb + i)));
+    }
+#elif defined(__ARM_NEON)
+    for (; i + 4 <= total; i += 4)
+    {
+        vst1q_f32(fo + i, vaddq_f32(vld1q_f32(fa + i), vld1q_f32(fb + i)));
+    }
+#endif
+    for (; i < total; i++)
+    {
+        fo[i] = fa[i] + fb[i];
+    }
+}
+
+/**
+ * @brief Normalizes a contiguous Vec3 array
+ * @param[out] out Where the normalized vectors go (may alias a)
+ * @param a The input vectors
+ * @param n The number of vectors
+ * @return nothing
+ * @remark Vectors shorter than EPSILON come out as zero, same as
+ * normalize_vec3.
+ */
+
+void vec3_normalize_n(Vec3* out, const Vec3* a, int n)
+{
+    int i = 0;
+#if defined(__SSE2__)
+    // four vectors per iteration: gather into x/y/z lanes, one sqrt for all four
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128 x = _mm_set_ps(a[i+3].x, a[i+2].x, a[i+1].x, a[i].x);
+        __m128 y = _mm_set_ps(a[i+3].y, a[i+2].y, a[i+1].y, a[i].y);
+        __m128 z = _mm_set_ps(a[i+3].z, a[i+2].z, a[i+1].z, a[i].z);
+        __m128 len = _mm_sqrt_ps(
+            _mm_add_ps(_mm_mul_ps(x, x), _mm_add_ps(_mm_mul_ps(y, y), _mm_mul_ps(z, z)))
+        );
+        __m128 tiny = _mm_cmplt_ps(len, _mm_set1_ps((float)EPSILON));
+        __m128 inv = _mm_andnot_ps(tiny, _mm_div_ps(_mm_set1_ps(1.0f), len));
+        x = _mm_mul_ps(x, inv);
+        y = _mm_mul_ps(y, inv);
+        z = _mm_mul_ps(z, inv);
+        float xs[4];
+        float ys[4];
+        float zs[4];
+        _mm_storeu_ps(xs, x);
+        _mm_storeu_ps(ys, y);
+        _mm_storeu_ps(zs, z);
+        for (int k = 0; k < 4; k++)
+        {
+            out[i + k].x = xs[k];
+            out[i + k].y = ys[k];
+            out[i + k].z = zs[k];
+        }
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    // vdivq/vsqrtq need aarch64; 32 bit arm takes the scalar tail
+    for (; i + 4 <= n; i += 4)
+    {
+        float32x4x3_t v = vld3q_f32((const float*)(a + i));
+        float32x4_t len = vsqrtq_f32(
+            vmlaq_f32(vmlaq_f32(vmulq_f32(v.val[0], v.val[0]), v.val[1], v.val[1]), v.val[2], v.val[2])
+        );
+        uint32x4_t tiny = vcltq_f32(len, vdupq_n_f32((float)EPSILON));
+        float32x4_t inv = vbslq_f32(tiny, vdupq_n_f32(0.0f), vdivq_f32(vdupq_n_f32(1.0f), len));
+        v.val[0] = vmulq_f32(v.val[0], inv);
+        v.val[1] = vmulq_f32(v.val[1], inv);
+        v.val[2] = vmulq_f32(v.val[2], inv);
+        vst3q_f32((float*)(out + i), v);
+    }
+#endif
+    for (; i < n; i++)
+    {
+        out[i] = normalize_vec3(a[i]);
+    }
+}
+
+/**
+ * @brief Computes normalized triangle normals for whole arrays at once
+ * @param[out] out Where the n normals go
+ * @param a The first vertices of the triangles
+ * @param b The second vertices
+ * @param c The third vertices
+ * @param n The number of triangles
+ * @return nothing
+ */
+
+void vec3_normal_n(Vec3* out, const Vec3* a, const Vec3* b, const Vec3* c, int n)
+{
+    // the cross products are branch-free and vectorize on their own;
+    // the sqrt-heavy normalization goes through the SIMD kernel
+    for (int i = 0; i < n; i++)
+    {
+        float abx = b[i].x - a[i].x;
+        float aby = b[i].y - a[i].y;
+        float abz = b[i].z - a[i].z;
+        float acx = c[i].x - a[i].x;
+        float acy = c[i].y - a[i].y;
+        float acz = c[i].z - a[i].z;
+        out[i].x = aby * acz - abz * acy;
+        out[i].y = abz * acx - abx * acz;
+        out[i].z = abx * acy - aby * acx;
+    }
+    vec3_normalize_n(out, out, n);
+}
+
+/**
+ * @brief This multiplies two quaternions
+ * @param q1 the first one 
+ * @param q2 the second one
+ * @return q1 * q2
+ */
+
+Quaternion quat_mul(Quaternion q1, Quaternion q2)
+{
+    return (Quaternion) 
+    {
+        .x = q1.w*q2.x + q1.x*q2.w + q1.y*q2.z - q1.z*q2.y,
+        .y = q1.w*q2.y - q1.x*q2.z + q1.y*q2.w + q1.z*q2.x,
+        .z = q1.w*q2.z + q1.x*q2.y - q1.y*q2.x + q1.z*q2.w,
+        .w = q1.w*q2.w - q1.x*q2.x - q1.y*q2.y - q1.z*q2.z
+    };
+}
+
+/**
+ * @brief This conjugates a quaternion
+ * @param q This is the quaternion
+ * @return This returns the conjugate of the quaternion
+ */
+
+Quaternion quat_conjugate(Quaternion q) 
+{
+    return (Quaternion)
+    {   
+        .x=-q.x, 
+        .y=-q.y, 
+        .z=-q.z, 
+        .w=q.w 
+    };
+}
+
+/**
+ * @brief This generates a quaternion from an angle/axis
+ * @param axis This is the axis to rotate around
+ * @param angle This is the angle of rotation
+ * @return A quaternion
+ */
+
+Quaternion quat_from_axis_angle(Vec3 axis, float angle) 
+{
+    axis = normalize_vec3(axis);
+    float half = angle * 0.5f;
+    float s = sinf(half);
+
+    return (Quaternion)
+    { 
+        .x=axis.x*s, 
+        .y=axis.y*s, 
+        .z=axis.z*s, 
+        .w=cosf(half) 
+    };
+}
+
+/**
+ * @brief This uses a rotation quaternion to rotate a vector
+ * @param q The quaternion
+ * @param v The vector
+ * @return The new rotated vec3.
+ */
+
+Vec3 quat_rotate_vec3(Quaternion q, Vec3 v) 
+{
+    Quaternion vq = { 
+        .x=v.x, 
+        .y=v.y, 
+        .z=v.z, 
+        .w=0.0f 
+    };
+    Quaternion qi = quat_conjugate(q);
+    Quaternion r = quat_mul(quat_mul(q, vq), qi);
+    return (Vec3)
+    { 
+        r.x, 
+        r.y, 
+        r.z 
+    };
+}
+
+/**
+ * @brief This generates a quaternion from an angle/axis
+ * @param axis This is the axis to rotate around
+ * @param angle This is the angle of rotation
+ * @param vec This is the vector to be rotated
+ * @return A vector
+ */
+
+Vec3 rotate_vector(Vec3 axis, float angle, Vec3 vec)
+{
+    Quaternion q = quat_from_axis_angle(axis, angle);
+    return quat_rotate_vec3(q, vec);
+}
+
+/// @def CANIM_PI
+/// @brief Pi, because strict c11 math.h keeps M_PI to itself
+#define CANIM_PI 3.14159265358979323846f
+
+/**
+ * @brief This takes the dot product of two quaternions
+ * @param a the first one
+ * @param b the second one
+ * @return the dot product
+ */
+
+float quat_dot(Quaternion a, Quaternion b)
+{
+    return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+}
+
+/**
+ * @brief Spherically interpolates between two quaternions
+ * @param a Where t=0 lands
+ * @param b Where t=1 lands
+ * @param t The blend factor
+ * @return The interpolated quaternion
+ * @remark Always takes the short way around, and falls back to a
+ * normalized lerp when the endpoints are nearly parallel (the acos/sin
+ * path divides by almost zero there and gains nothing).
+ */
+
+Quaternion quat_slerp(Quaternion a, Quaternion b, float t)
+{
+    float dot = quat_dot(a, b);
+    if (dot < 0)
+    {
+        b = (Quaternion){ .x = -b.x, .y = -b.y, .z = -b.z, .w = -b.w };
+        dot = -dot;
+    }
+    if (dot > 0.9995f)
+    {
+        Quaternion r =
+        {
+            .x = a.x + (b.x - a.x) * t,
+            .y = a.y + (b.y - a.y) * t,
+            .z = a.z + (b.z - a.z) * t,
+            .w = a.w + (b.w - a.w) * t
+        };
+        float mag = sqrtf(quat_dot(r, r));
+        if (mag < EPSILON)
+        {
+            return a;
+        }
+        float inv = 1.0f / mag;
+        r.x *= inv;
+        r.y *= inv;
+        r.z *= inv;
+        r.w *= inv;
+        return r;
+    }
+    float theta = acosf(dot);
+    float s = sinf(theta);
+    float wa = sinf((1 - t) * theta) / s;
+    float wb = sinf(t * theta) / s;
+    return (Quaternion)
+    {
+        .x = a.x * wa + b.x * wb,
+        .y = a.y * wa + b.y * wb,
+        .z = a.z * wa + b.z * wb,
+        .w = a.w * wa + b.w * wb
+    };
+}
+
+/*
+    The 4x4 matrices below are flat float[16] in OpenGL column-major
+    order, ready to hand to glUniformMatrix4fv without a transpose.
+*/
+
+/**
+ * @brief Multiplies two 4x4 matrices
+ * @param[out] out Where a * b goes (must not alias a or b)
+ * @param a The left matrix
+ * @param b The right matrix
+ * @return nothing
+ */
+
+void mat4_mul(float* out, const float* a, const float* b)
+{
+    for (int c = 0; c < 4; c++)
+    {
+        for (int r = 0; r < 4; r++)
+        {
+            out[c * 4 + r] =
+                a[0 * 4 + r] * b[c * 4 + 0] +
+                a[1 * 4 + r] * b[c * 4 + 1] +
+                a[2 * 4 + r] * b[c * 4 + 2] +
+                a[3 * 4 + r] * b[c * 4 + 3];
+        }
+    }
+}
+
+/**
+ * @brief Builds a perspective frustum matrix (same numbers glFrustum used)
+ * @param[out] out Where the matrix goes
+ * @param l The left clip plane
+ * @param r The right one
+ * @param b The bottom one
+ * @param t The top one
+ * @param n The near plane
+ * @param f The far plane
+ * @return nothing
+ */
+
+void mat4_frustum(float* out, float l, float r, float b, float t, float n, float f)
+{
+    memset(out, 0, 16 * sizeof(float));
+    out[0] = 2 * n / (r - l);
+    out[5] = 2 * n / (t - b);
+    out[8] = (r + l) / (r - l);
+    out[9] = (t + b) / (t - b);
+    out[10] = -(f + n) / (f - n);
+    out[11] = -1;
+    out[14] = -2 * f * n / (f - n);
+}
+
+/**
+ * @brief Builds a rotation matrix from a quaternion
+ * @param[out] out Where the matrix goes (translation part is identity)
+ * @param q The rotation
+ * @return nothing
+ */
+
+void mat4_from_quat(float* out, Quaternion q)
+{
+    float xx = q.x * q.x;
+    float yy = q.y * q.y;
+    float zz = q.z * q.z;
+    float xy = q.x * q.y;
+    float xz = q.x * q.z;
+    float yz = q.y * q.z;
+    float wx = q.w * q.x;
+    float wy = q.w * q.y;
+    float wz = q.w * q.z;
+    out[0] = 1 - 2 * (yy + zz);
+    out[1] = 2 * (xy + wz);
+    out[2] = 2 * (xz - wy);
+    out[3] = 0;
+    out[4] = 2 * (xy - wz);
+    out[5] = 1 - 2 * (xx + zz);
+    out[6] = 2 * (yz + wx);
+    out[7] = 0;
+    out[8] = 2 * (xz + wy);
+    out[9] = 2 * (yz - wx);
+    out[10] = 1 - 2 * (xx + yy);
+    out[11] = 0;
+    out[12] = 0;
+    out[13] = 0;
+    out[14] = 0;
+    out[15] = 1;
+}
+
+/**
+ * @brief Builds a view matrix from a camera pose
+ * @param[out] out Where the matrix goes
+ * @param position Where the camera sits
+ * @param orientation Which way it points
+ * @return nothing
+ * @remark The view is the inverse of the camera's pose: rotate by the
+ * conjugate, then translate by the negated position carried through
+ * that rotation.
+ */
+
+void camera_view_matrix(float* out, Vec3 position, Quaternion orientation)
+{
+    Quaternion inv = quat_conjugate(orientation);
+    mat4_from_quat(out, inv);
+    Vec3 p = quat_rotate_vec3(inv, position);
+    out[12] = -p.x;
+    out[13] = -p.y;
+    out[14] = -p.z;
+}
+
+/**
+ * @brief One camera keyframe: where the camera is and which way it
+ * points at one moment
+ */
+
+typedef struct
+{
+    /**
+     * @brief When this keyframe happens (seconds)
+     */
+    float t;
+    /**
+     * @brief Where the camera sits
+     */
+    Vec3 position;
+    /**
+     * @brief Which way it points
+     */
+    Quaternion orientation;
+}
+CameraKeyframe;
+
+/**
+ * @brief A keyframed camera path
+ */
+
+typedef struct
+{
+    /**
+     * @brief The keyframes, sorted by time
+     */
+    CameraKeyframe* keys;
+    /**
+     * @brief How many there are
+     */
+    int key_count;
+    /**
+     * @brief The segment the last eval landed in
+     * @remark Playback is monotone almost always, so the next eval is
+     * either here or one segment over; the cache makes the per-frame
+     * cost O(1) instead of a search.
+     */
+    int segment;
+}
+CameraPath;
+
+/**
+ * @brief Creates a camera path from a list of keyframes
+ * @param[out] result The status
+ * @param keys The keyframes, sorted by time (they get copied)
+ * @param key_count How many there are
+ * @return The path, or null on error
+ */
+
+CameraPath* create_camera_path(CanimResult* result, const CameraKeyframe* keys, int key_count)
+{
+    if (key_count < 1)
+    {
+        *result = NOOP;
+        return null;
+    }
+    CameraPath* path = malloc(sizeof(CameraPath));
+    if (!path)
+    {
+        *result = CAMERA_PATH_MALLOC_ERROR;
+        return null;
+    }
+    path->keys = malloc(key_count * sizeof(CameraKeyframe));
+    if (!path->keys)
+    {
+        free(path);
+        *result = CAMERA_PATH_MALLOC_ERROR;
+        return null;
+    }
+    memcpy(path->keys, keys, key_count * sizeof(CameraKeyframe));
+    path->key_count = key_count;
+    path->segment = 0;
+    *result = SUCCESS;
+    return path;
+}
+
+/**
+ * @brief Evaluates the camera pose at a time
+ * @param path The path
+ * @param t The time (seconds)
+ * @param[out] position Where the camera sits at t
+ * @param[out] orientation Which way it points at t
+ * @return nothing
+ * @remark Times outside the path clamp to the first/last keyframe. A
+ * seek backwards (a loop wrapping around, say) just resets the cached
+ * segment and pays one rescan.
+ */
+
+void camera_path_eval(CameraPath* path, float t, Vec3* position, Quaternion* orientation)
+{
+    if (path->key_count == 1 || t <= path->keys[0].t)
+    {
+        *position = path->keys[0].position;
+        *orientation = path->keys[0].orientation;
+        path->segment = 0;
+        return;
+    }
+    if (t >= path->keys[path->key_count - 1].t)
+    {
+        *position = path->keys[path->key_count - 1].position;
+        *orientation = path->keys[path->key_count - 1].orientation;
+        path->segment = path->key_count - 2;
+        return;
+    }
+    if (t < path->keys[path->segment].t)
+    {
+        path->segment = 0;
+    }
+    for (;t >= path->keys[path->segment + 1].t;)
+    {
+        path->segment++;
+    }
+    CameraKeyframe* a = &path->keys[path->segment];
+    CameraKeyframe* b = &path->keys[path->segment + 1];
+    float u = (t - a->t) / (b->t - a->t);
+    *position = lerp_vec3(a->position, b->position, u);
+    *orientation = quat_slerp(a->orientation, b->orientation, u);
+}
+
+/**
+ * @brief Frees a camera path
+ * @param path The path
+ * @return nothing
+ */
+
+void free_camera_path(CameraPath* path)
+{
+    if (!path)
+    {
+        return;
+    }
+    free(path->keys);
+    free(path);
+}
+
+/**
+ * @brief This checks if two segments are intersecting
+ * @param a This parameter is the first vertex of the first edge
+ * @param b This parameter is the second vertex of the first edge
+ * @param c This parameter is the first vertex of the second edge
+ * @param d This parameter is the second vertex of the second edge.
+ * @param[out] out If the edges intersect, this outputs where they intersect.
+ * @return This outputs 1 if they intersect but 0 if they don't
+ */
+
+int intersecting_segments(Vec3 a, Vec3 b, Vec3 c, Vec3 d, Vec3* out)
+{    
+    if (
+        fabs(a.x-b.x) < EPSILON && 
+        fabs(a.y-b.y) < EPSILON && 
+        fabs(c.x-d.x) < EPSILON && 
+        fabs(c.y-d.y) < EPSILON 
+    )
+    {
+        return 0;
+    }
+    float tx; 
+    float ty;
+    int vertical = 0;
+    float denomx;
+    float denomy;
+    if (
+        fabs(a.x-b.x) < EPSILON && 
+        fabs(a.y-b.y) < EPSILON 
+    )
+    {
+        tx = (a.x - c.x);
+        ty = (a.y - c.y);
+        denomx = d.x - c.x;
+        denomy = d.y - c.y;
+        vertical = 1;
+    }
+    if (
+        fabs(c.x - d.x) < EPSILON &&
+        fabs(c.y - d.y) < EPSILON
+    )   
+    {
+        tx = (c.x - a.x);
+        ty = (c.y - a.y);
+        denomx = b.x - a.x;
+        denomy = b.x - a.y; // if you change this line of code, i will end you
+        vertical = 2;
+    }
+    if (vertical > 0)
+    {
+        if (fabs(denomx) < EPSILON)
+        {
+            return 0;
+        }
+        if (fabs(denomy) < EPSILON)
+        {
+            return 0;
+        }
+        
+        tx /= denomx;
+        ty /= denomy;
+        if (tx < 0 || tx > 1)
+        {
+            return 0;
+        }
+        if (ty < 0 || ty > 1)
+        {
+            return 0;
+        }
+        
+        float t_avg;
+        if (fabs(tx - ty) < EPSILON)
+        {
+            t_avg = (tx + ty) / 2;
+        }
+        else
+        {
+            return 0;
+        }
+        if (vertical == 1)
+        {
+            *out = lerp_vec3(c, d, t_avg);
+        }
+        else if (vertical == 2)
+        {
+            *out = lerp_vec3(a, b, t_avg);
+        }
+        return 1;
+    }
+    float denom = (a.x - b.x)*(c.y - d.y) - (a.y - b.y)*(c.x - d.x);
+
+    if (fabs(denom) < EPSILON)
+    {
+        return 0;
+    }
+    float t = ((a.x - c.x)*(c.y - d.y) - (a.y - c.y)*(c.x-d.x)) / denom;
+    float u = -((a.x - b.x)*(a.y - c.y) - (a.y - b.y)*(a.x-c.x)) / denom;
+    if (t < 0 || t > 1)
+    {
+        return 0;
+    }
+    if (u < 0 || u > 1)
+    {
+        return 0;
+    }
+
+    Vec3 v1 = lerp_vec3(a, b, t);
+    Vec3 v2 = lerp_vec3(c, d, u);
+    if (fabs(v1.z - v2.z) < EPSILON)
+    {
+        *out = lerp_vec3(v1, v2, 0.5f);
+        return 1;
+    }
+    return 0;
+}
+
+/// @def ARENA_ALIGNMENT
+/// @brief Every arena allocation is rounded up to this many bytes
+#define ARENA_ALIGNMENT 16
+
+/// @def ARENA_CHUNK_SIZE
+/// @brief Default chunk size; a face that needs more gets a bigger chunk
+#define ARENA_CHUNK_SIZE (1 << 20)
+
+/**
+ * @brief Hands out n bytes from the arena
+ * @param[out] result The status
+ * @param arena The arena
+ * @param n How many bytes
+ * @return The memory, or null on chunk allocation failure
+ */
+
+static void* arena_alloc(CanimResult* result, Arena* arena, size_t n)
+{
+    n = (n + (ARENA_ALIGNMENT - 1)) & ~(size_t)(ARENA_ALIGNMENT - 1);
+    ArenaChunk* chunk = arena->chunks;
+    if (!chunk || chunk->capacity - chunk->used < n)
+    {
+        size_t capacity = n > ARENA_CHUNK_SIZE ? n : ARENA_CHUNK_SIZE;
+        chunk = malloc(sizeof(ArenaChunk) + capacity);
+        if (!chunk)
+        {
+            *result = ARENA_CHUNK_MALLOC_ERROR;
+            return null;
+        }
+        CANIM_PROF_ALLOC(CANIM_PROF_TRIANGULATE, sizeof(ArenaChunk) + capacity);
+        chunk->next = arena->chunks;
+        chunk->capacity = capacity;
+        chunk->used = 0;
+        arena->chunks = chunk;
+    }
+    void* p = chunk->data + chunk->used;
+    chunk->used += n;
+    *result = SUCCESS;
+    return p;
+}
+
+/**
+ * @brief Grows an arena allocation
+ * @param[out] result The status
+ * @param arena The arena
+ * @param old The old allocation (or null)
+ * @param old_size How many bytes the old allocation holds
+ * @param new_size How many bytes are wanted now
+ * @return The (possibly moved) memory, or null on failure
+ * @remark The most recent allocation grows in place when its chunk still
+ * has room; anything else gets a fresh block and a memcpy. Shrinking is a
+ * no-op because the reset reclaims everything anyway.
+ */
+
+static void* arena_realloc(CanimResult* result, Arena* arena, void* old, size_t old_size, size_t new_size)
+{
+    if (old != null && new_size <= old_size)
+    {
+        *result = SUCCESS;
+        return old;
+    }
+    size_t old_aligned = (old_size + (ARENA_ALIGNMENT - 1)) & ~(size_t)(ARENA_ALIGNMENT - 1);
+    size_t new_aligned = (new_size + (ARENA_ALIGNMENT - 1)) & ~(size_t)(ARENA_ALIGNMENT - 1);
+    ArenaChunk* chunk = arena->chunks;
+    if
+    (
+        old != null && chunk != null &&
+        (unsigned char*)old == chunk->data + chunk->used - old_aligned &&
+        chunk->capacity - chunk->used >= new_aligned - old_aligned
+    )
+    {
+        chunk->used += new_aligned - old_aligned;
+        *result = SUCCESS;
+        return old;
+    }
+    void* fresh = arena_alloc(result, arena, new_size);
+    if (!fresh)
+    {
+        return null;
+    }
+    if (old != null)
+    {
+        memcpy(fresh, old, old_size);
+    }
+    return fresh;
+}
+
+/**
+ * @brief Throws every allocation back into the arena
+ * @param arena The arena
+ * @return nothing
+ * @remark One chunk is kept warm so the next face starts without a malloc
+ * at all; the overflow chunks go back to the system.
+ */
+
+static void arena_reset(Arena* arena)
+{
+    for (;arena->chunks != null && arena->chunks->next != null;)
+    {
+        ArenaChunk* dead = arena->chunks;
+        arena->chunks = dead->next;
+        free(dead);
+    }
+    if (arena->chunks != null)
+    {
+        arena->chunks->used = 0;
+    }
+}
+
+/**
+ * @brief Frees the arena's chunks for real
+ * @param arena The arena
+ * @return nothing
+ */
+
+static void arena_destroy(Arena* arena)
+{
+    for (;arena->chunks != null;)
+    {
+        ArenaChunk* dead = arena->chunks;
+        arena->chunks = dead->next;
+        free(dead);
+    }
+}
+
+/**
+ * @brief This generates a PSLG from a polygon
+ * @param[out] result This outputs the errors
+ * @param vertices These are the vertices of the polygon
+ * @param vertex_count This is the number of the vertices
+ * @param arena The arena the pslg and everything inside it allocates from
+ * @return This outputs the PSLG (or a pointer to it but nobody asked)
+ */
+
+PSLG* generate_pslg(CanimResult* result, PolygonRaw pr, Arena* arena)
+{
+    PSLG* new = arena_alloc(result, arena, sizeof(PSLG));
+    if(!new)
+    {
+        *result = PSLG_INIT_MALLOC_ERROR;
+        return null;
+    }
+    new->arena = arena;
+    new->vertex_count = pr.vertex_count;
+    new->edge_count = pr.vertex_count;
+    new->vertices = arena_alloc(result, arena, BIT_ALIGN(pr.vertex_count) * sizeof(Vec3));
+    if (!new->vertices)
+    {
+        new->vertex_count = 0;
+        new->edge_count = 0;
+        new->edges = null;
+        *result = PSLG_VERTEX_MALLOC_ERROR;
+        return null;
+    }
+    for (int i = 0; i < pr.vertex_count; i++)
+    {
+        new->vertices[i] = pr.vertices[i];
+    }
+
+    new->edges = arena_alloc(result, arena, BIT_ALIGN(new->edge_count) * sizeof(int[2]));
+    if (!new->edges)
+    {
+        new->vertex_count = 0;
+        new->edge_count = 0;
+        *result = PSLG_EDGE_MALLOC_ERROR;
+        return null;
+    }
+
+    for (int i = 0; i < pr.vertex_count; i++)
+    {
+        new->edges[i][0] = i;
+        new->edges[i][1] = (i + 1) % pr.vertex_count; 
+    }
+    new->poly = pr;
+    *result = SUCCESS;
+    return new;
+}
+
+/// @def DEDUP_CELL_SIZE
+/// @brief Side length of a spatial hash cell. Two vertices closer than
+/// EPSILON always land in the same or an adjacent cell.
+#define DEDUP_CELL_SIZE (4.0 * EPSILON)
+
+/**
+ * @brief Hashes a quantized grid cell
+ * @param ix The cell x index
+ * @param iy The cell y index
+ * @param iz The cell z index
+ * @return The hash of the cell
+ */
+
+static uint32_t dedup_cell_hash(long ix, long iy, long iz)
+{
+    // three large primes, the classic spatial hash
+    uint32_t h = (uint32_t)ix * 73856093u;
+    h ^= (uint32_t)iy * 19349663u;
+    h ^= (uint32_t)iz * 83492791u;
+    return h;
+}
+
+/**
+ * @brief This deduplicates all vertices
+ * @param[out] result This outputs result
+ * @param pslg The pslg
+ * @return nothing
+ * @remark This is a single pass over a spatial hash grid: every vertex is
+ * matched against the vertices in its own and neighbouring cells, merged
+ * vertices are redirected through one remap table, and the vertex and edge
+ * arrays are compacted exactly once. The old path rescanned every vertex
+ * pair and shifted the whole array per merge, which was cubic.
+ */
+
+void dedup_pslg_vertex(CanimResult* result, PSLG* pslg)
+{
+    int n = pslg->vertex_count;
+    if (n < 2)
+    {
+        *result = SUCCESS;
+        return;
+    }
+    uint32_t table_size = 1;
+    for (;table_size < (uint32_t)(n * 2);)
+    {
+        table_size <<= 1;
+    }
+    // chained buckets: head per table slot, next per vertex
+    int* head = malloc(table_size * sizeof(int));
+    int* next = malloc(n * sizeof(int));
+    int* remap = malloc(n * sizeof(int));
+    if (!head || !next || !remap)
+    {
+        free(head);
+        free(next);
+        free(remap);
+        *result = DEDUP_PSLG_HASH_MALLOC_ERROR;
+        return;
+    }
+    for (uint32_t i = 0; i < table_size; i++)
+    {
+        head[i] = -1;
+    }
+    for (int i = 0; i < n; i++)
+    {
+        Vec3 v = pslg->vertices[i];
+        long ix = (long)floor(v.x / DEDUP_CELL_SIZE);
+        long iy = (long)floor(v.y / DEDUP_CELL_SIZE);
+        long iz = (long)floor(v.z / DEDUP_CELL_SIZE);
+        int found = -1;
+        for (long dx = -1; dx <= 1 && found < 0; dx++)
+        {
+            for (long dy = -1; dy <= 1 && found < 0; dy++)
+            {
+                for (long dz = -1; dz <= 1 && found < 0; dz++)
+                {
+                    uint32_t slot = dedup_cell_hash(ix + dx, iy + dy, iz + dz) & (table_size - 1);
+                    for (int j = head[slot]; j >= 0; j = next[j])
+                    {
+                        if (equal_vec3(v, pslg->vertices[j]))
+                        {
+                            found = j;
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+        if (found >= 0)
+        {
+            remap[i] = found;
+        }
+        else
+        {
+            remap[i] = i;
+            uint32_t slot = dedup_cell_hash(ix, iy, iz) & (table_size - 1);
+            next[i] = head[slot];
+            head[slot] = i;
+        }
+    }
+    free(head);
+    free(next);
+    // compact the survivors in place and remap edge endpoints once
+    int* new_idx = malloc(n * sizeof(int));
+    if (!new_idx)
+    {
+        free(remap);
+        *result = DEDUP_PSLG_HASH_MALLOC_ERROR;
+        return;
+    }
+    int kept = 0;
+    for (int i = 0; i < n; i++)
+    {
+        if (remap[i] == i)
+        {
+            pslg->vertices[kept] = pslg->vertices[i];
+            new_idx[i] = kept;
+            kept++;
+        }
+    }
+    for (int i = 0; i < pslg->edge_count; i++)
+    {
+        pslg->edges[i][0] = new_idx[remap[pslg->edges[i][0]]];
+        pslg->edges[i][1] = new_idx[remap[pslg->edges[i][1]]];
+    }
+    free(new_idx);
+    free(remap);
+    // no shrink: the slack lives in the arena and the reset reclaims it
+    pslg->vertex_count = kept;
+    *result = SUCCESS;
+}
+
+/**
+ * @brief Hashes an undirected edge by its sorted endpoint pair
+ * @param lo The smaller endpoint index
+ * @param hi The larger endpoint index
+ * @return The hash
+ */
+
+static uint32_t dedup_edge_hash(int lo, int hi)
+{
+    uint32_t h = (uint32_t)lo * 2654435761u;
+    h ^= (uint32_t)hi * 2246822519u;
+    return h;
+}
+
+/**
+ * @brief Deduplicates the pslg edges
+ * @param[out] result The result
+ * @param pslg The PSLG to be deduplicated
+ * @return nothing
+ * @remark One pass over a hash set keyed on the sorted (v1, v2) pair.
+ * This runs after vertex dedup, so position-equal endpoints already
+ * share an index and index comparison is enough. The old path compared
+ * every edge pair and restarted after each removal.
+ */
+
+void dedup_pslg_edge(CanimResult* result, PSLG* pslg)
+{
+    int n = pslg->edge_count;
+    if (n < 2)
+    {
+        *result = SUCCESS;
+        return;
+    }
+    uint32_t table_size = 1;
+    for (;table_size < (uint32_t)(n * 2);)
+    {
+        table_size <<= 1;
+    }
+    int* head = malloc(table_size * sizeof(int));
+    int* next = malloc(n * sizeof(int));
+    if (!head || !next)
+    {
+        free(head);
+        free(next);
+        *result = DEDUP_PSLG_HASH_MALLOC_ERROR;
+        return;
+    }
+    for (uint32_t i = 0; i < table_size; i++)
+    {
+        head[i] = -1;
+    }
+    int kept = 0;
+    for (int i = 0; i < n; i++)
+    {
+        int lo = pslg->edges[i][0];
+        int hi = pslg->edges[i][1];
+        if (lo > hi)
+        {
+            int t = lo;
+            lo = hi;
+            hi = t;
+        }
+        uint32_t slot = dedup_edge_hash(lo, hi) & (table_size - 1);
+        bool dup = false;
+        for (int j = head[slot]; j >= 0; j = next[j])
+        {
+            int jlo = pslg->edges[j][0];
+            int jhi = pslg->edges[j][1];
+            if (jlo > jhi)
+            {
+                int t = jlo;
+                jlo = jhi;
+                jhi = t;
+            }
+            if (jlo == lo && jhi == hi)
+            {
+                dup = true;
+                break;
+            }
+        }
+        if (dup)
+        {
+            continue;
+        }
+        pslg->edges[kept][0] = pslg->edges[i][0];
+        pslg->edges[kept][1] = pslg->edges[i][1];
+        next[kept] = head[slot];
+        head[slot] = kept;
+        kept++;
+    }
+    free(head);
+    free(next);
+    // no shrink: the slack lives in the arena and the reset reclaims it
+    pslg->edge_count = kept;
+    *result = SUCCESS;
+}
+
+/**
+ * @brief Deduplicates the entire pslg
+ * @param[out] result The result
+ * @param pslg The pslg to be deduplicated
+ * @return nothing
+ */
+
+void dedup_pslg(CanimResult* result, PSLG* pslg)
+{
+    dedup_pslg_vertex(result, pslg);
+    if (IS_AN_ERROR(*result))
+    {
+        return;
+    }
+    dedup_pslg_edge(result, pslg);
+    if (IS_AN_ERROR(*result))
+    {
+        return;
+    }
+    *result = SUCCESS;
+}
+
+/**
+ * @brief This takes two edges and splits a PSLG if neccesary
+ * @param[out] result This outputs the errors and status
+ * @param pslg This is the input pslg
+ * @param edge1 This is the first edge
+ * @param edge2 This is the second edge
+ * @return This outputs nothing. 
+ */
+
+
+void splitPSLG(CanimResult* result, PSLG* pslg, int edge1, int edge2)
+{
+    Vec3 out;
+    if
+    (
+        pslg->edges[edge1][0] == pslg->edges[edge2][0] ||
+        pslg->edges[edge1][0] == pslg->edges[edge2][1] ||
+        pslg->edges[edge1][1] == pslg->edges[edge2][0] ||
+        pslg->edges[edge1][1] == pslg->edges[edge2][1]
+    )
+    {
+        *result = NOOP;
+        return;
+    }
+
+    Vec3 v1 = pslg->vertices[pslg->edges[edge1][0]];
+    Vec3 v2 = pslg->vertices[pslg->edges[edge1][1]];
+    Vec3 v3 = pslg->vertices[pslg->edges[edge2][0]];
+    Vec3 v4 = pslg->vertices[pslg->edges[edge2][1]];
+    int intersection = 
+        intersecting_segments(
+            v1,
+            v2,
+            v3,
+            v4,
+            &out
+        );
+    if (intersection == 0)
+    {
+        *result = NOOP;
+        return;
+    }
+
+    if (REALIGN(pslg->vertex_count, pslg->vertex_count + 1))
+    {
+        Vec3* temp_ptr = arena_realloc(result, pslg->arena, pslg->vertices,
+            sizeof(Vec3) * BIT_ALIGN(pslg->vertex_count),
+            sizeof(Vec3) * BIT_ALIGN(pslg->vertex_count + 1));
+        if (temp_ptr == null)
+        {
+            *result = PSLG_EDGE_SPLIT_VERTEX_REALLOC_ERROR;
+            return;
+        }
+        pslg->vertices = temp_ptr;
+    }
+    if (REALIGN(pslg->edge_count, pslg->edge_count + 2))
+    {
+        int (*temp_ptr)[2] = arena_realloc(result, pslg->arena, pslg->edges,
+            sizeof(int[2]) * BIT_ALIGN(pslg->edge_count),
+            sizeof(int[2]) * BIT_ALIGN(pslg->edge_count + 2));
+        if (temp_ptr == null)
+        {
+            *result = PSLG_EDGE_SPLIT_EDGE_REALLOC_ERROR;
+            return;
+        }
+        pslg->edges = temp_ptr;
+    }
+    pslg->vertices[pslg->vertex_count] = out;
+    pslg->edges[pslg->edge_count][0] = pslg->edges[edge1][1];
+    pslg->edges[pslg->edge_count][1] = pslg->vertex_count;
+    pslg->edges[pslg->edge_count+1][0] = pslg->edges[edge2][1];
+    pslg->edges[pslg->edge_count+1][1] = pslg->vertex_count;
+    pslg->edges[edge1][1] = pslg->vertex_count;
+    pslg->edges[edge2][1] = pslg->vertex_count;
+    pslg->edge_count+=2;
+    pslg->vertex_count+=1;
+    *result = SUCCESS;
+}
+
+/**
+ * @brief One splitting round over a uniform grid of candidate edge pairs
+ * @param[out] result The status
+ * @param pslg The pslg
+ * @param[out] splits How many splits this round performed
+ * @return nothing
+ * @remark Edges are binned into a 2D grid by their xy bounding boxes, and
+ * only pairs sharing a cell are tested (each pair in exactly one cell, the
+ * top-left cell their boxes overlap in). Edges appended mid-round are
+ * picked up by the next round, so no restart-from-scratch is needed.
+ */
+
+static void split_round(CanimResult* result, PSLG* pslg, int* splits)
+{
+    *splits = 0;
+    int n = pslg->edge_count;
+    if (n < 2)
+    {
+        *result = SUCCESS;
+        return;
+    }
+    float minx = pslg->vertices[0].x;
+    float maxx = minx;
+    float miny = pslg->vertices[0].y;
+    float maxy = miny;
+    for (int i = 1; i < pslg->vertex_count; i++)
+    {
+        minx = pslg->vertices[i].x < minx ? pslg->vertices[i].x : minx;
+        maxx = pslg->vertices[i].x > maxx ? pslg->vertices[i].x : maxx;
+        miny = pslg->vertices[i].y < miny ? pslg->vertices[i].y : miny;
+        maxy = pslg->vertices[i].y > maxy ? pslg->vertices[i].y : maxy;
+    }
+    int grid = 1;
+    for (;grid * grid < n && grid < 256;)
+    {
+        grid <<= 1;
+    }
+    float cell_w = (maxx - minx) / grid;
+    float cell_h = (maxy - miny) / grid;
+    if (cell_w < (float)EPSILON)
+    {
+        cell_w = 1.0f;
+    }
+    if (cell_h < (float)EPSILON)
+    {
+        cell_h = 1.0f;
+    }
+    // per-edge cell ranges, then chained (edge, cell) entries
+    int (*range)[4] = malloc(n * sizeof(int[4]));
+    if (!range)
+    {
+        *result = SPLIT_GRID_MALLOC_ERROR;
+        return;
+    }
+    size_t entries = 0;
+    for (int i = 0; i < n; i++)
+    {
+        Vec3 p = pslg->vertices[pslg->edges[i][0]];
+        Vec3 q = pslg->vertices[pslg->edges[i][1]];
+        float lox = p.x < q.x ? p.x : q.x;
+        float hix = p.x > q.x ? p.x : q.x;
+        float loy = p.y < q.y ? p.y : q.y;
+        float hiy = p.y > q.y ? p.y : q.y;
+        int x0 = (int)((lox - minx) / cell_w);
+        int x1 = (int)((hix - minx) / cell_w);
+        int y0 = (int)((loy - miny) / cell_h);
+        int y1 = (int)((hiy - miny) / cell_h);
+        x0 = x0 < 0 ? 0 : (x0 > grid - 1 ? grid - 1 : x0);
+        x1 = x1 < 0 ? 0 : (x1 > grid - 1 ? grid - 1 : x1);
+        y0 = y0 < 0 ? 0 : (y0 > grid - 1 ? grid - 1 : y0);
+        y1 = y1 < 0 ? 0 : (y1 > grid - 1 ? grid - 1 : y1);
+        range[i][0] = x0;
+        range[i][1] = x1;
+        range[i][2] = y0;
+        range[i][3] = y1;
+        entries += (size_t)(x1 - x0 + 1) * (y1 - y0 + 1);
+    }
+    int* head = malloc((size_t)grid * grid * sizeof(int));
+    int* entry_edge = malloc(max(entries, 1) * sizeof(int));
+    int* entry_next = malloc(max(entries, 1) * sizeof(int));
+    if (!head || !entry_edge || !entry_next)
+    {
+        free(range);
+        free(head);
+        free(entry_edge);
+        free(entry_next);
+        *result = SPLIT_GRID_MALLOC_ERROR;
+        return;
+    }
+    for (int i = 0; i < grid * grid; i++)
+    {
+        head[i] = -1;
+    }
+    size_t e = 0;
+    for (int i = 0; i < n; i++)
+    {
+        for (int y = range[i][2]; y <= range[i][3]; y++)
+        {
+            for (int x = range[i][0]; x <= range[i][1]; x++)
+            {
+                entry_edge[e] = i;
+                entry_next[e] = head[y * grid + x];
+                head[y * grid + x] = (int)e;
+                e++;
+            }
+        }
+    }
+    for (int cell = 0; cell < grid * grid; cell++)
+    {
+        int cx = cell % grid;
+        int cy = cell / grid;
+        for (int a = head[cell]; a >= 0; a = entry_next[a])
+        {
+            for (int b = entry_next[a]; b >= 0; b = entry_next[b])
+            {
+                int i = entry_edge[a];
+                int j = entry_edge[b];
+                if (i == j)
+                {
+                    continue;
+                }
+                // only test a pair in the top-left cell both boxes share
+                int ox = max(range[i][0], range[j][0]);
+                int oy = max(range[i][2], range[j][2]);
+                if (ox != cx || oy != cy)
+                {
+                    continue;
+                }
+                splitPSLG(result, pslg, i, j);
+                if (IS_AN_ERROR(*result))
+                {
+                    free(range);
+                    free(head);
+                    free(entry_edge);
+                    free(entry_next);
+                    return;
+                }
+                if (*result == SUCCESS)
+                {
+                    (*splits)++;
+                }
+            }
+        }
+    }
+    free(range);
+    free(head);
+    free(entry_edge);
+    free(entry_next);
+    *result = SUCCESS;
+}
+
+/**
+ * @brief This splits it entirely
+ * @param[out] result The status
+ * @param pslg The pslg that need be split
+ * @return This outputs nothing
+ * @remark Rounds of grid-accelerated batch splitting run until a round
+ * makes no split. The old path rescanned every edge pair after every
+ * single split, which was cubic in the edge count.
+ */
+
+void split_entirely(CanimResult* result, PSLG* pslg)
+{
+    CANIM_PROF_BEGIN(CANIM_PROF_SPLIT);
+    for(;;)
+    {
+        int splits = 0;
+        split_round(result, pslg, &splits);
+        if(IS_AN_ERROR(*result))
+        {
+            break;
+        }
+        if (splits == 0)
+        {
+            *result = SUCCESS;
+            break;
+        }
+        dedup_pslg(result, pslg);
+        if(IS_AN_ERROR(*result))
+        {
+            break;
+        }
+    }
+    CANIM_PROF_END(CANIM_PROF_SPLIT);
+}
+
+/**
+ * @brief This takes a pslg and makes an empty triangulation and merges them
+ * @param[out] result This is the status
+ * @param pslg This is the pslg that we use to construct the PSLGTriangulation
+ * @return This is the resulting PSLGTriangulation
+ */
+
+PSLGTriangulation* create_pslg_triangulation(CanimResult* result, PSLG* pslg)
+{
+    PSLGTriangulation* pslgtri = arena_alloc(result, pslg->arena, sizeof(PSLGTriangulation));
+    if (!pslgtri)
+    {
+        *result = PSLG_TRIANGULATION_INIT_MALLOC_ERROR;
+        return null;
+    }
+    pslgtri->triangulation = empty_triangulation(result);
+    if (IS_AN_ERROR(*result))
+    {
+        return null;
+    }
+    pslgtri->pslg = pslg;
+    *result = SUCCESS;
+    return pslgtri;
+}
+
+/**
+ * @brief This attacks a vertex
+ * @param[out] result This is the status
+ * @param pslgtri The PSLGTriangulation that has the vertex to be attacked
+ * @param vertex_idx The index of the vertex
+ * @return Nothing
+ */
+
+void attack_vertex(CanimResult* result, PSLGTriangulation* pslgtri, int vertex_idx)
+{   
+    PSLG* pslg = pslgtri->pslg;
+    Triangulation* tri = pslgtri->triangulation;
+    int d = 0;
+    int e1;
+    int e2;
+    for(int i = 0; i < pslg->edge_count; i++)
+    {
+        if
+        (
+            pslg->edges[i][0] == vertex_idx ||
+            pslg->edges[i][1] == vertex_idx
+        )
+        {
+            d++;
+            if (d > 2)
+            {
+                *result = NOOP;
+                return;
+            }
+            if (d > 1)
+            {
+                e2 = i;
+            }
+            else
+            {
+                e1 = i;
+            }
+        }
+    }
+    if (d != 2)
+    {
+        *result = NOOP;
+        return;
+    }
+    int v1 = pslg->edges[e1][0];
+    int v2 = pslg->edges[e2][0];
+    int v3 = pslg->edges[e2][1];
+    if (v1 == vertex_idx)
+    {
+        v1 = pslg->edges[e1][1];
+    }
+    if (v2 == vertex_idx)
+    {
+        v2 = pslg->edges[e2][1];
+        v3 = pslg->edges[e2][0];
+    }
+    TriangleRaw tr;
+    tr.fd = pslgtri->pslg->poly.fd;
+    tr.vertices[0] = pslg->vertices[v1];
+    tr.vertices[1] = pslg->vertices[v2];
+    tr.vertices[2] = pslg->vertices[v3];
+    add_triangle(result, tri, tr);
+    if (IS_AN_ERROR(*result))
+    {
+        return;
+    }
+    int e3_exists = 0;
+    for(int i = 0; i < pslg->edge_count; i++)
+    {
+        if
+        (
+            (pslg->edges[i][0] == v1 && pslg->edges[i][1] == v2) ||
+            (pslg->edges[i][0] == v2 && pslg->edges[i][1] == v1)
+        )
+        {   
+            e3_exists = 1;
+            break;
+        }
+    }
+    int ecount = e3_exists ? pslg->edge_count - 2 : pslg->edge_count - 1;
+    int (*temp)[2] = arena_alloc(result, pslg->arena, ecount * sizeof(int[2])); // this isn't aligned because it is gonna DIE SOON.
+    if (temp == null)
+    {
+
+        *result = PSLG_ATTACK_TEMP_EDGES_MALLOC_ERROR;
+        return;
+    }
+
+    int EI = 0;
+    for (int i = 0; i < pslg->edge_count; i++)
+    {
+        // sacrifice e1, and e2
+        if (i == e1 || i == e2)
+        {
+            continue;
+        }
+        temp[EI][0] = pslg->edges[i][0];
+        temp[EI][1] = pslg->edges[i][1];
+
+        EI++;
+    }
+
+    // so e3_exists
+    // handle it
+    if (!e3_exists)
+    {
+        temp[EI][0] = v1;
+        temp[EI][1] = v2;
+    }
+    pslg->edge_count = ecount;
+    // time to populate the data (no shrink, the arena reset reclaims the slack)
+    for (int i = 0; i < ecount; i++)
+    {
+        pslg->edges[i][0] = temp[i][0];
+        pslg->edges[i][1] = temp[i][1];
+    }
+    *result = SUCCESS;
+}
+
+/**
+ * @brief This attacks a single vertex
+ * @param[out] result This is the status
+ * @param pslgtri This is the PSLGTriangulation to attack
+ * @return nothing
+ */
+
+void attack_single_vertex(CanimResult* result, PSLGTriangulation* pslgtri)
+{
+    for(int i = 0; i < pslgtri->pslg->vertex_count; i++)
+    {
+        CANIM_PROF_BEGIN(CANIM_PROF_ATTACK);
+        attack_vertex(result, pslgtri, i);
+        CANIM_PROF_END(CANIM_PROF_ATTACK);
+        if (*result == SUCCESS)
+        {
+            return;
+        }
+        if(*result == NOOP)
+        {
+            continue;
+        }
+        return;
+    }
+    *result = NOOP;
+}
+
+/**
+ * @brief This attacks a all vertices
+ * @param[out] result This is the status
+ * @param pslgtri This is the PSLGTriangulation to attack
+ * @return nothing
+ * @remark Incremental: one pass builds per-vertex incidence lists and
+ * degrees, then a worklist of degree-2 vertices drives the attacks. Each
+ * attack retires its two edges in place (dead edges are skipped lazily,
+ * never compacted mid-run) and only re-examines the two neighbours it
+ * touched, so an n-vertex face costs O(n) amortized instead of the old
+ * rescan-everything-per-attack O(n^2). The priority here is trivial on
+ * purpose: the only vertices this clipper can take are degree-2 ones, so
+ * a worklist does what a heap would, without the log factor. The old
+ * one-shot attack_vertex path stays for callers that want a single step.
+ */
+
+void attack_all_vertices(CanimResult* result, PSLGTriangulation* pslgtri)
+{
+    PSLG* pslg = pslgtri->pslg;
+    int n = pslg->vertex_count;
+    int m = pslg->edge_count;
+    if (n == 0 || m == 0)
+    {
+        *result = SUCCESS;
+        return;
+    }
+    /*
+        Every attack removes two edges and adds at most one, and each
+        attack retires a vertex, so the edge array never outgrows m + n
+        and the worklist never sees more than 3n pushes (n initial
+        degree-2 vertices plus two neighbours per attack).
+    */
+    int cap = m + n;
+    int* head = arena_alloc(result, pslg->arena, n * sizeof(int));
+    int* deg = arena_alloc(result, pslg->arena, n * sizeof(int));
+    int* next = arena_alloc(result, pslg->arena, 2 * cap * sizeof(int));
+    bool* alive = arena_alloc(result, pslg->arena, cap * sizeof(bool));
+    int (*edges)[2] = arena_alloc(result, pslg->arena, cap * sizeof(int[2]));
+    int* worklist = arena_alloc(result, pslg->arena, 3 * n * sizeof(int));
+    if (!head || !deg || !next || !alive || !edges || !worklist)
+    {
+        *result = ATTACK_ADJACENCY_MALLOC_ERROR;
+        return;
+    }
+    memcpy(edges, pslg->edges, m * sizeof(int[2]));
+    for (int v = 0; v < n; v++)
+    {
+        head[v] = -1;
+        deg[v] = 0;
+    }
+    // a slot 2e+side names one endpoint of edge e in the incidence chains
+    for (int e = 0; e < m; e++)
+    {
+        alive[e] = true;
+        for (int side = 0; side < 2; side++)
+        {
+            int v = edges[e][side];
+            next[2 * e + side] = head[v];
+            head[v] = 2 * e + side;
+            deg[v]++;
+        }
+    }
+    int edge_count = m;
+    int top = 0;
+    for (int v = n - 1; v >= 0; v--)
+    {
+        if (deg[v] == 2)
+        {
+            worklist[top++] = v;
+        }
+    }
+    for (;top > 0;)
+    {
+        int v = worklist[--top];
+        if (deg[v] != 2)
+        {
+            // its degree moved on since it was pushed
+            continue;
+        }
+        CANIM_PROF_BEGIN(CANIM_PROF_ATTACK);
+        int e1 = -1;
+        int e2 = -1;
+        for (int s = head[v]; s >= 0; s = next[s])
+        {
+            int e = s >> 1;
+            if (!alive[e])
+            {
+                continue;
+            }
+            if (e1 < 0)
+            {
+                e1 = e;
+            }
+            else
+            {
+                e2 = e;
+                break;
+            }
+        }
+        // same winding the one-shot attack_vertex produces: (v1, v2, v)
+        int v1 = edges[e1][0] == v ? edges[e1][1] : edges[e1][0];
+        int v2 = edges[e2][0];
+        int v3 = edges[e2][1];
+        if (v2 == v)
+        {
+            v2 = edges[e2][1];
+            v3 = edges[e2][0];
+        }
+        TriangleRaw tr;
+        tr.fd = pslg->poly.fd;
+        tr.vertices[0] = pslg->vertices[v1];
+        tr.vertices[1] = pslg->vertices[v2];
+        tr.vertices[2] = pslg->vertices[v3];
+        add_triangle(result, pslgtri->triangulation, tr);
+        if (IS_AN_ERROR(*result))
+        {
+            return;
+        }
+        // retire the ear: e1 and e2 die, v drops out of the graph
+        alive[e1] = false;
+        alive[e2] = false;
+        deg[v] = 0;
+        deg[v1]--;
+        deg[v2]--;
+        // the closing edge only goes in if it isn't there already; probe
+        // the smaller of the two incidence lists
+        int probe = deg[v1] <= deg[v2] ? v1 : v2;
+        int other = probe == v1 ? v2 : v1;
+        bool e3_exists = false;
+        for (int s = head[probe]; s >= 0; s = next[s])
+        {
+            int e = s >> 1;
+            if (!alive[e])
+            {
+                continue;
+            }
+            if (edges[e][0] == other || edges[e][1] == other)
+            {
+                e3_exists = true;
+                break;
+            }
+        }
+        if (!e3_exists)
+        {
+            int e = edge_count++;
+            edges[e][0] = v1;
+            edges[e][1] = v2;
+            alive[e] = true;
+            next[2 * e + 0] = head[v1];
+            head[v1] = 2 * e + 0;
+            next[2 * e + 1] = head[v2];
+            head[v2] = 2 * e + 1;
+            deg[v1]++;
+            deg[v2]++;
+        }
+        // only the two touched neighbours can have become attackable
+        if (deg[v1] == 2)
+        {
+            worklist[top++] = v1;
+        }
+        if (deg[v2] == 2)
+        {
+            worklist[top++] = v2;
+        }
+        CANIM_PROF_END(CANIM_PROF_ATTACK);
+    }
+    /*
+        One compaction at the very end instead of one per attack; the net
+        edge count only ever shrank, so the pslg's own array has room.
+    */
+    int live = 0;
+    for (int e = 0; e < edge_count; e++)
+    {
+        if (!alive[e])
+        {
+            continue;
+        }
+        pslg->edges[live][0] = edges[e][0];
+        pslg->edges[live][1] = edges[e][1];
+        live++;
+    }
+    pslg->edge_count = live;
+    *result = SUCCESS;
+}
+
+/**
+ * @brief This generates a triangulation of a polygon
+ * @param[out] result This is the status
+ * @param vertices These are the vertices
+ * @param vertex_count This is the amount of vertices
+ * @param tri This is where the triangulation will be stored.
+ * @param arena The arena the pslg machinery allocates from; the caller
+ * resets it once the face is done
+ * @return output nothing
+ */
+
+void generate_triangulation(CanimResult* result, PolygonRaw pr, Triangulation* tri, Arena* arena)
+{
+    PSLG* pslg = generate_pslg(result, pr, arena);
+    if (IS_AN_ERROR(*result))
+    {
+        return;
+    }
+    split_entirely(result, pslg);
+    if (IS_AN_ERROR(*result))
+    {
+        return;
+    }
+
+    PSLGTriangulation* pslgtri = create_pslg_triangulation(result, pslg);
+    if (IS_AN_ERROR(*result))
+    {
+        return;
+    }
+    attack_all_vertices(result, pslgtri);
+    if (IS_AN_ERROR(*result))
+    {
+        free_triangulation(pslgtri->triangulation);
+        return;
+    }
+
+    reserve_triangulation(result, tri, tri->triangle_count + pslgtri->triangulation->triangle_count);
+    if (IS_AN_ERROR(*result))
+    {
+        free_triangulation(pslgtri->triangulation);
+        return;
+    }
+    for(int i = 0; i < pslgtri->triangulation->triangle_count; i++)
+    {
+        add_triangle(result, tri,
+            pslgtri->triangulation->triangles[i]
+        );
+        if (IS_AN_ERROR(*result))
+        {
+            free_triangulation(pslgtri->triangulation);
+            return;
+        }
+    }
+    tri->triangle_count = pslgtri->triangulation->triangle_count;
+
+    free_triangulation(pslgtri->triangulation);
+    *result = SUCCESS;
+}
+
+/**
+ * @brief Triangulates one face of a polyhedron
+ * @param[out] result The status
+ * @param poly The polyhedron owning the face
+ * @param face_idx The index of the face
+ * @param[out] out Where the freshly allocated triangulation pointer goes
+ * @param arena The scratch arena for the pslg pipeline, reset on the way out
+ * @return nothing
+ * @remark Faces only read from the polyhedron and write to their own
+ * output slot, so this is safe to run from several workers at once as long
+ * as every worker brings its own arena.
+ */
+
+void triangulate_face(CanimResult* result, Polyhedron* poly, int face_idx, Triangulation** out, Arena* arena)
+{
+    Triangulation* t = empty_triangulation(result);
+    if (IS_AN_ERROR(*result))
+    {
+        return;
+    }
+    PolygonIndexed* face = &poly->poly[face_idx];
+    Vec3* verts = arena_alloc(result, arena, BIT_ALIGN(face->vertex_count) * sizeof(Vec3));
+    if (!verts)
+    {
+        *result = TRIANGULATE_POLYHEDRON_VERTEX_MALLOC_ERROR;
+        free_triangulation(t);
+        return;
+    }
+
+    for (int v = 0; v < face->vertex_count; v++)
+    {
+        verts[v] = poly->vertices[face->vertices[v]];
+    }
+
+    PolygonRaw pr =
+    {
+        .vertex_count = face->vertex_count,
+        .vertices = verts,
+        .fd = face->fd
+    };
+
+    generate_triangulation(result, pr, t, arena);
+    arena_reset(arena);
+    if (IS_AN_ERROR(*result))
+    {
+        free_triangulation(t);
+        return;
+    }
+
+    *out = t;
+}
+
+/**
+ * @brief Shared state for the face triangulation worker pool
+ */
+
+typedef struct
+{
+    /**
+     *  @brief The polyhedron being triangulated
+     *  */
+    Polyhedron* poly;
+    /**
+     *  @brief The per-face output slots
+     *  */
+    Triangulation** tris;
+    /**
+     *  @brief The next face nobody has claimed yet
+     *  */
+    SDL_atomic_t next_face;
+    /**
+     *  @brief Set once a worker hits an error, everyone else bails
+     *  */
+    SDL_atomic_t stop;
+    /**
+     *  @brief The first error anyone hit (the one that gets reported)
+     *  */
+    SDL_atomic_t first_error;
+}
+TriangulateJob;
+
+/**
+ * @brief Worker loop: claim faces until there are none left (or someone failed)
+ * @param data The TriangulateJob
+ * @return always 0, the real status travels through the job
+ */
+
+static int triangulate_polyhedron_worker(void* data)
+{
+    TriangulateJob* job = data;
+    CanimResult result = SUCCESS;
+    // one scratch arena per worker, reused for every face it claims
+    Arena arena = { null };
+    for (;;)
+    {
+        if (SDL_AtomicGet(&job->stop))
+        {
+            break;
+        }
+        int i = SDL_AtomicAdd(&job->next_face, 1);
+        if (i >= job->poly->face_count)
+        {
+            break;
+        }
+        triangulate_face(&result, job->poly, i, &job->tris[i], &arena);
+        if (IS_AN_ERROR(result))
+        {
+            // first one to raise the flag gets its error reported
+            if (SDL_AtomicCAS(&job->stop, 0, 1))
+            {
+                SDL_AtomicSet(&job->first_error, (int)result);
+            }
+            break;
+        }
+    }
+    arena_destroy(&arena);
+    return 0;
+}
+
+/**
+ * @brief Triangulates the polyhedron
+ * @param[out] result The status
+ * @param poly The polyhedron to be triangulated
+ * @param out Where the triangulation is stored
+ * @return nothing
+ * @remark Faces are triangulated concurrently by a small worker pool (one
+ * worker per core, capped by the face count); the calling thread joins the
+ * pool too, so a failed thread spawn just means less parallelism. The
+ * per-thread results are merged at the end exactly like the serial path
+ * did.
+ */
+
+void triangulate_polyhedron(CanimResult* result, Polyhedron* poly, Triangulation* out)
+{
+    CANIM_PROF_BEGIN(CANIM_PROF_TRIANGULATE);
+    Triangulation** tris = malloc(poly->face_count * sizeof(Triangulation*));
+    if (!tris)
+    {
+        *result = TRIANGULATE_POLYHEDRON_BATCH_TRIANGULATIONS_MALLOC_ERROR;
+        return;
+    }
+
+    for (int i = 0; i < poly->face_count; i++)
+    {
+        tris[i] = NULL;
+    }
+
+    TriangulateJob job;
+    job.poly = poly;
+    job.tris = tris;
+    SDL_AtomicSet(&job.next_face, 0);
+    SDL_AtomicSet(&job.stop, 0);
+    SDL_AtomicSet(&job.first_error, (int)SUCCESS);
+
+    int nworkers = SDL_GetCPUCount();
+    if (nworkers > poly->face_count)
+    {
+        nworkers = poly->face_count;
+    }
+    if (nworkers < 1)
+    {
+        nworkers = 1;
+    }
+    // the calling thread is worker zero, so spawn one fewer
+    SDL_Thread** threads = null;
+    int spawned = 0;
+    if (nworkers > 1)
+    {
+        threads = malloc((nworkers - 1) * sizeof(SDL_Thread*));
+        if (threads)
+        {
+            for (int i = 0; i < nworkers - 1; i++)
+            {
+                threads[spawned] = SDL_CreateThread(triangulate_polyhedron_worker, "canim_tri", &job);
+                if (threads[spawned])
+                {
+                    spawned++;
+                }
+            }
+        }
+    }
+    triangulate_polyhedron_worker(&job);
+    for (int i = 0; i < spawned; i++)
+    {
+        SDL_WaitThread(threads[i], null);
+    }
+    free(threads);
+
+    if (SDL_AtomicGet(&job.stop))
+    {
+        *result = (CanimResult)SDL_AtomicGet(&job.first_error);
+        for (int i = 0; i < poly->face_count; i++)
+        {
+            if (tris[i])
+            {
+                free_triangulation(tris[i]);
+            }
+        }
+        free(tris);
+        return;
+    }
+
+    merge_triangulations(result, tris, poly->face_count, out);
+    for (int i = 0; i < poly->face_count; i++)
+    {
+        if (tris[i])
+        {
+            free_triangulation(tris[i]);
+        }
+    }
+    free(tris);
+
+    if (IS_AN_ERROR(*result))
+    {
+        return;
+    }
+
+    CANIM_PROF_END(CANIM_PROF_TRIANGULATE);
+    *result = SUCCESS;
+}
+
+
+/**
+ * @brief This frees an indexed triangulation
+ * @param itri The indexed triangulation to be freed
+ * @return nothing
+ */
+
+void free_indexed_triangulation(IndexedTriangulation* itri)
+{
+    if (!itri)
+    {
+        return;
+    }
+    if (itri->gpu.vbo)
+    {
+        pglDeleteBuffers(1, &itri->gpu.vbo);
+    }
+    if (itri->gpu.ibo)
+    {
+        pglDeleteBuffers(1, &itri->gpu.ibo);
+    }
+    if (itri->gpu.vao)
+    {
+        pglDeleteVertexArrays(1, &itri->gpu.vao);
+    }
+    free(itri->vertices);
+    free(itri->triangles);
+    free(itri);
+}
+
+/**
+ * @brief Builds an indexed triangulation out of a raw one
+ * @param[out] result The status
+ * @param src The raw triangulation
+ * @return The indexed triangulation (vertex pool + index triples)
+ * @remark Positions are pooled with the same spatial hash the PSLG dedup
+ * uses, so vertices within EPSILON of each other share one pool slot.
+ * Face data stays per-triangle, exactly like TriangleRaw stored it.
+ */
+
+IndexedTriangulation* index_triangulation(CanimResult* result, Triangulation* src)
+{
+    IndexedTriangulation* itri = malloc(sizeof(IndexedTriangulation));
+    if (!itri)
+    {
+        *result = INDEXED_TRI_MALLOC_ERROR;
+        return null;
+    }
+    int ncorners = src->triangle_count * 3;
+    itri->triangle_count = src->triangle_count;
+    itri->vertex_count = 0;
+    itri->gpu = (IndexedTriangulationGPU){0};
+    itri->triangles = malloc(max(src->triangle_count, 1) * sizeof(TriangleIndexed));
+    itri->vertices = malloc(max(ncorners, 1) * sizeof(Vec3));
+    if (!itri->triangles || !itri->vertices)
+    {
+        free(itri->triangles);
+        free(itri->vertices);
+        free(itri);
+        *result = INDEXED_TRI_MALLOC_ERROR;
+        return null;
+    }
+    uint32_t table_size = 1;
+    for (;table_size < (uint32_t)(ncorners * 2 + 2);)
+    {
+        table_size <<= 1;
+    }
+    int* head = malloc(table_size * sizeof(int));
+    int* next = malloc(max(ncorners, 1) * sizeof(int));
+    if (!head || !next)
+    {
+        free(head);
+        free(next);
+        free_indexed_triangulation(itri);
+        *result = INDEXED_TRI_MALLOC_ERROR;
+        return null;
+    }
+    for (uint32_t i = 0; i < table_size; i++)
+    {
+        head[i] = -1;
+    }
+    for (int i = 0; i < src->triangle_count; i++)
+    {
+        itri->triangles[i].fd = src->triangles[i].fd;
+        for (int v = 0; v < 3; v++)
+        {
+            Vec3 p = src->triangles[i].vertices[v];
+            long ix = (long)floor(p.x / DEDUP_CELL_SIZE);
+            long iy = (long)floor(p.y / DEDUP_CELL_SIZE);
+            long iz = (long)floor(p.z / DEDUP_CELL_SIZE);
+            int found = -1;
+            for (long dx = -1; dx <= 1 && found < 0; dx++)
+            {
+                for (long dy = -1; dy <= 1 && found < 0; dy++)
+                {
+                    for (long dz = -1; dz <= 1 && found < 0; dz++)
+                    {
+                        uint32_t slot = dedup_cell_hash(ix + dx, iy + dy, iz + dz) & (table_size - 1);
+                        for (int j = head[slot]; j >= 0; j = next[j])
+                        {
+                            if (equal_vec3(p, itri->vertices[j]))
+                            {
+                                found = j;
+                                break;
+                            }
+                        }
+                    }
+                }
+            }
+            if (found < 0)
+            {
+                found = itri->vertex_count;
+                itri->vertices[found] = p;
+                uint32_t slot = dedup_cell_hash(ix, iy, iz) & (table_size - 1);
+                next[found] = head[slot];
+                head[slot] = found;
+                itri->vertex_count++;
+            }
+            itri->triangles[i].vertices[v] = found;
+        }
+    }
+    free(head);
+    free(next);
+    // shrink the pool to what actually survived pooling
+    if (itri->vertex_count > 0 && itri->vertex_count < ncorners)
+    {
+        Vec3* temp = realloc(itri->vertices, itri->vertex_count * sizeof(Vec3));
+        if (temp)
+        {
+            itri->vertices = temp;
+        }
+    }
+    *result = SUCCESS;
+    return itri;
+}
+
+/**
+ * @brief Expands an indexed triangulation back into a raw one
+ * @param[out] result The status
+ * @param src The indexed triangulation
+ * @return The raw triangulation
+ */
+
+Triangulation* deindex_triangulation(CanimResult* result, IndexedTriangulation* src)
+{
+    Triangulation* tri = empty_triangulation(result);
+    if (IS_AN_ERROR(*result))
+    {
+        return null;
+    }
+    reserve_triangulation(result, tri, src->triangle_count);
+    if (IS_AN_ERROR(*result))
+    {
+        free_triangulation(tri);
+        return null;
+    }
+    for (int i = 0; i < src->triangle_count; i++)
+    {
+        TriangleRaw tr;
+        tr.fd = src->triangles[i].fd;
+        tr.vertices[0] = src->vertices[src->triangles[i].vertices[0]];
+        tr.vertices[1] = src->vertices[src->triangles[i].vertices[1]];
+        tr.vertices[2] = src->vertices[src->triangles[i].vertices[2]];
+        add_triangle(result, tri, tr);
+        if (IS_AN_ERROR(*result))
+        {
+            free_triangulation(tri);
+            return null;
+        }
+    }
+    *result = SUCCESS;
+    return tri;
+}
+
+/**
+ * @brief How many levels a level-of-detail chain holds at most: the exact
+ * mesh plus two decimated ones
+ */
+
+#define LOD_LEVELS 3
+
+/**
+ * @brief A mesh at several levels of detail
+ * @remark Level 0 is the exact mesh; every further level has roughly a
+ * quarter of the triangles of the one before it. The draw side picks a
+ * level from the camera distance, so background solids in wide shots stop
+ * paying full vertex load for detail nobody can see while the hero mesh
+ * up close stays exact.
+ */
+
+typedef struct
+{
+    /**
+     *  @brief The meshes, coarsest last (unused slots are null)
+     *  */
+    IndexedTriangulation* levels[LOD_LEVELS];
+    /**
+     *  @brief How many levels actually exist
+     *  */
+    int level_count;
+    /**
+     *  @brief The distance where level 1 takes over; each further level
+     *  takes twice the distance of the one before
+     *  */
+    float switch_distance;
+}
+LODChain;
+
+/**
+ * @brief An edge candidate for collapsing, with its length as the cost
+ */
+
+typedef struct
+{
+    /**
+     *  @brief One endpoint (a pool index)
+     *  */
+    int a;
+    /**
+     *  @brief The other endpoint
+     *  */
+    int b;
+    /**
+     *  @brief How long the edge is (shorter collapses first)
+     *  */
+    float len;
+}
+LODEdge;
+
+/**
+ * @brief qsort comparator: shortest edge first
+ * @param pa One edge
+ * @param pb The other edge
+ * @return the usual -1/0/1
+ */
+
+static int lod_edge_cmp(const void* pa, const void* pb)
+{
+    const LODEdge* x = pa;
+    const LODEdge* y = pb;
+    return (x->len > y->len) - (x->len < y->len);
+}
+
+/**
+ * @brief Chases a vertex through the collapse remap, with path halving
+ * @param remap The remap table (remap[v] == v means v survives)
+ * @param v The vertex to chase
+ * @return The surviving representative
+ */
+
+static int lod_find(int* remap, int v)
+{
+    for (;remap[v] != v;)
+    {
+        remap[v] = remap[remap[v]];
+        v = remap[v];
+    }
+    return v;
+}
+
+/**
+ * @brief Decimates an indexed triangulation down to (about) a target
+ * triangle count by collapsing short edges to their midpoints
+ * @param[out] result The status
+ * @param src The mesh to decimate (left untouched)
+ * @param target_triangles How many triangles to aim for
+ * @return The decimated copy
+ * @remark Greedy shortest-edge-midpoint collapse in passes: each pass
+ * sorts the live edges once, then collapses from the short end, skipping
+ * any edge whose endpoints were already touched this pass (so one sort
+ * serves many collapses instead of a heap update per collapse). A full
+ * quadric metric would place the survivors better, but on our convex-ish
+ * solids midpoints look the same from the distances where a coarse level
+ * is ever on screen.
+ */
+
+IndexedTriangulation* decimate_indexed_triangulation(CanimResult* result, const IndexedTriangulation* src, int target_triangles)
+{
+    Vec3* verts = malloc(max(src->vertex_count, 1) * sizeof(Vec3));
+    TriangleIndexed* tris = malloc(max(src->triangle_count, 1) * sizeof(TriangleIndexed));
+    int* remap = malloc(max(src->vertex_count, 1) * sizeof(int));
+    bool* touched = malloc(max(src->vertex_count, 1) * sizeof(bool));
+    LODEdge* edges = malloc(max(src->triangle_count * 3, 1) * sizeof(LODEdge));
+    if (!verts || !tris || !remap || !touched || !edges)
+    {
+        free(verts);
+        free(tris);
+        free(remap);
+        free(touched);
+        free(edges);
+        *result = LOD_CHAIN_MALLOC_ERROR;
+        return null;
+    }
+    memcpy(verts, src->vertices, src->vertex_count * sizeof(Vec3));
+    memcpy(tris, src->triangles, src->triangle_count * sizeof(TriangleIndexed));
+    for (int i = 0; i < src->vertex_count; i++)
+    {
+        remap[i] = i;
+    }
+    int tri_count = src->triangle_count;
+    for (;tri_count > target_triangles;)
+    {
+        int edge_count = 0;
+        for (int i = 0; i < tri_count; i++)
+        {
+            for (int v = 0; v < 3; v++)
+            {
+                int a = tris[i].vertices[v];
+                int b = tris[i].vertices[(v + 1) % 3];
+                edges[edge_count].a = a;
+                edges[edge_count].b = b;
+                edges[edge_count].len = dist_vec3(verts[a], verts[b]);
+                edge_count++;
+            }
+        }
+        qsort(edges, edge_count, sizeof(LODEdge), lod_edge_cmp);
+        for (int i = 0; i < src->vertex_count; i++)
+        {
+            touched[i] = false;
+        }
+        // a manifold collapse kills two triangles; the estimate only
+        // paces the pass, the compaction below recounts exactly
+        int collapsed = 0;
+        for (int i = 0; i < edge_count && tri_count - 2 * collapsed > target_triangles; i++)
+        {
+            int a = lod_find(remap, edges[i].a);
+            int b = lod_find(remap, edges[i].b);
+            if (a == b || touched[a] || touched[b])
+            {
+                continue;
+            }
+            verts[a] = lerp_vec3(verts[a], verts[b], 0.5f);
+            remap[b] = a;
+            touched[a] = true;
+            touched[b] = true;
+            collapsed++;
+        }
+        if (collapsed == 0)
+        {
+            // nothing left to collapse, target or not
+            break;
+        }
+        // rewrite the survivors through the remap and drop the triangles
+        // a collapse squashed flat
+        int w = 0;
+        for (int i = 0; i < tri_count; i++)
+        {
+            int v0 = lod_find(remap, tris[i].vertices[0]);
+            int v1 = lod_find(remap, tris[i].vertices[1]);
+            int v2 = lod_find(remap, tris[i].vertices[2]);
+            if (v0 == v1 || v1 == v2 || v0 == v2)
+            {
+                continue;
+            }
+            tris[w].vertices[0] = v0;
+            tris[w].vertices[1] = v1;
+            tris[w].vertices[2] = v2;
+            tris[w].fd = tris[i].fd;
+            tris[w].fd.normal = normal_vec3(verts[v0], verts[v1], verts[v2]);
+            w++;
+        }
+        tri_count = w;
+    }
+    free(edges);
+    free(touched);
+    // compact the vertex pool to just the survivors, reusing remap as the
+    // old-to-new table
+    for (int i = 0; i < src->vertex_count; i++)
+    {
+        remap[i] = -1;
+    }
+    IndexedTriangulation* out = malloc(sizeof(IndexedTriangulation));
+    if (!out)
+    {
+        free(verts);
+        free(tris);
+        free(remap);
+        *result = LOD_CHAIN_MALLOC_ERROR;
+        return null;
+    }
+    out->gpu = (IndexedTriangulationGPU){0};
+    out->triangle_count = tri_count;
+    out->vertex_count = 0;
+    out->triangles = malloc(max(tri_count, 1) * sizeof(TriangleIndexed));
+    out->vertices = malloc(max(src->vertex_count, 1) * sizeof(Vec3));
+    if (!out->triangles || !out->vertices)
+    {
+        free(verts);
+        free(tris);
+        free(remap);
+        free_indexed_triangulation(out);
+        *result = LOD_CHAIN_MALLOC_ERROR;
+        return null;
+    }
+    for (int i = 0; i < tri_count; i++)
+    {
+        out->triangles[i].fd = tris[i].fd;
+        for (int v = 0; v < 3; v++)
+        {
+            int old = tris[i].vertices[v];
+            if (remap[old] < 0)
+            {
+                remap[old] = out->vertex_count;
+                out->vertices[out->vertex_count] = verts[old];
+                out->vertex_count++;
+            }
+            out->triangles[i].vertices[v] = remap[old];
+        }
+    }
+    free(verts);
+    free(tris);
+    free(remap);
+    if (out->vertex_count > 0 && out->vertex_count < src->vertex_count)
+    {
+        Vec3* temp = realloc(out->vertices, out->vertex_count * sizeof(Vec3));
+        if (temp)
+        {
+            out->vertices = temp;
+        }
+    }
+    *result = SUCCESS;
+    return out;
+}
+
+/**
+ * @brief Frees a level-of-detail chain and every level in it
+ * @param lod The chain (null is fine)
+ * @return nothing
+ */
+
+void free_lod_chain(LODChain* lod)
+{
+    if (!lod)
+    {
+        return;
+    }
+    for (int i = 0; i < LOD_LEVELS; i++)
+    {
+        free_indexed_triangulation(lod->levels[i]);
+    }
+    free(lod);
+}
+
+/**
+ * @brief Builds a level-of-detail chain from an exact mesh
+ * @param[out] result The status
+ * @param full The exact mesh; the chain takes ownership (and frees it on
+ * error)
+ * @param switch_distance The distance where the first coarse level takes
+ * over
+ * @return The chain
+ * @remark Every level targets a quarter of the triangles of the one
+ * before, so the full chain cuts an order of magnitude; decimation stops
+ * early on meshes too small to be worth it.
+ */
+
+LODChain* build_lod_chain(CanimResult* result, IndexedTriangulation* full, float switch_distance)
+{
+    LODChain* lod = malloc(sizeof(LODChain));
+    if (!lod)
+    {
+        free_indexed_triangulation(full);
+        *result = LOD_CHAIN_MALLOC_ERROR;
+        return null;
+    }
+    for (int i = 0; i < LOD_LEVELS; i++)
+    {
+        lod->levels[i] = null;
+    }
+    lod->levels[0] = full;
+    lod->level_count = 1;
+    lod->switch_distance = switch_distance;
+    for (int i = 1; i < LOD_LEVELS; i++)
+    {
+        IndexedTriangulation* prev = lod->levels[i - 1];
+        int target = prev->triangle_count / 4;
+        if (target < 16)
+        {
+            // already coarse enough that another level saves nothing
+            break;
+        }
+        IndexedTriangulation* coarse = decimate_indexed_triangulation(result, prev, target);
+        if (IS_AN_ERROR(*result))
+        {
+            free_lod_chain(lod);
+            return null;
+        }
+        if (coarse->triangle_count >= prev->triangle_count)
+        {
+            // the collapse stalled; a level that saves nothing earns nothing
+            free_indexed_triangulation(coarse);
+            break;
+        }
+        lod->levels[i] = coarse;
+        lod->level_count++;
+    }
+    *result = SUCCESS;
+    return lod;
+}
+
+/**
+ * @brief Picks the level for a camera distance
+ * @param lod The chain
+ * @param distance How far the camera is from the mesh
+ * @return The mesh to draw
+ * @remark Level 1 kicks in at switch_distance and every further level at
+ * double the distance of the one before, which roughly tracks how screen
+ * size shrinks.
+ */
+
+IndexedTriangulation* lod_chain_select(LODChain* lod, float distance)
+{
+    int level = 0;
+    float d = lod->switch_distance;
+    for (;level + 1 < lod->level_count && distance >= d;)
+    {
+        level++;
+        d *= 2.0f;
+    }
+    return lod->levels[level];
+}
+
+/**
+ * @brief This takes a polyhedron and frees it
+ * @param poly This is the polyhedron to be freed
+ * @return nothing
+ */
+
+
+void free_polyhedron(Polyhedron* poly)
+{
+    if (!poly) 
+    {
+        return;
+    }
+    
+
+    if (poly->poly)
+    {
+        for (int i = 0; i < poly->face_count; i++)
+        {
+            PolygonIndexed* face = &poly->poly[i];
+            if (face->vertices)
+            {
+                free(face->vertices);
+            }
+        }
+        free(poly->poly);
+    }
+
+    if (poly->vertices)
+    {
+        free(poly->vertices);
+    }
+
+    free(poly);
+}
+
+
+
+/**
+ * @brief This allocates memory for a polyhedron
+ * @param[out] result This is the status of this function
+ * @param nv The vertex count
+ * @param nf The face count
+ * @return A pointer to your brand new polyhedron
+ */
+
+Polyhedron* create_polyhedron(CanimResult* result, int nv, int nf) 
+{
+    Polyhedron* poly = malloc(sizeof(Polyhedron));
+    if (!poly)
+    {
+        *result = POLYHEDRON_MALLOC_ERROR;
+        return NULL;
+    }
+    poly->face_count=nf;
+    poly->vertex_count=nv;
+    poly->vertices = malloc(sizeof(Vec3) * nv);
+    if(!poly->vertices)
+    {
+        free(poly);
+        *result = POLYHEDRON_VERTEX_MALLOC_ERROR;
+        return NULL;
+    }
+    poly->poly = malloc(sizeof(PolygonIndexed) * nf);
+    if(!poly->poly)
+    {
+        free(poly->vertices);
+        free(poly);
+        *result = POLYHEDRON_FACE_MALLOC_ERROR;
+        return NULL;
+    }
+    return poly;
+}
+
+
+/**
+ * @brief A cursor over an off file slurped into memory
+ */
+
+typedef struct
+{
+    /**
+     *  @brief The next unconsumed byte
+     *  */
+    const char* p;
+    /**
+     *  @brief One past the last byte
+     *  */
+    const char* end;
+}
+OFFScanner;
+
+/**
+ * @brief Skips whitespace, newlines, and # comments
+ * @param s The scanner
+ * @return nothing
+ */
+
+static void off_skip_separators(OFFScanner* s)
+{
+    for (;s->p < s->end;)
+    {
+        char c = *s->p;
+        if (c == '#')
+        {
+            for (;s->p < s->end && *s->p != '\n';)
+            {
+                s->p++;
+            }
+        }
+        else if (c == ' ' || c == '\t' || c == '\r' || c == '\n')
+        {
+            s->p++;
+        }
+        else
+        {
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Skips the rest of the current line (trailing tokens, comments)
+ * @param s The scanner
+ * @return nothing
+ */
+
+static void off_skip_line(OFFScanner* s)
+{
+    for (;s->p < s->end && *s->p != '\n';)
+    {
+        s->p++;
+    }
+}
+
+/**
+ * @brief Scans the next float token
+ * @param[out] result The status ( @p on_fail when no float is there)
+ * @param s The scanner
+ * @param on_fail The error to report when scanning fails
+ * @return The float
+ */
+
+static float off_scan_float(CanimResult* result, OFFScanner* s, CanimResult on_fail)
+{
+    off_skip_separators(s);
+    char* endp;
+    float v = strtof(s->p, &endp);
+    if (endp == s->p)
+    {
+        *result = on_fail;
+        return 0.0f;
+    }
+    s->p = endp;
+    *result = SUCCESS;
+    return v;
+}
+
+/**
+ * @brief Scans the next int token
+ * @param[out] result The status ( @p on_fail when no int is there)
+ * @param s The scanner
+ * @param on_fail The error to report when scanning fails
+ * @return The int
+ */
+
+static int off_scan_int(CanimResult* result, OFFScanner* s, CanimResult on_fail)
+{
+    off_skip_separators(s);
+    char* endp;
+    long v = strtol(s->p, &endp, 10);
+    if (endp == s->p)
+    {
+        *result = on_fail;
+        return 0;
+    }
+    s->p = endp;
+    *result = SUCCESS;
+    return (int)v;
+}
+
+/**
+ * @brief Reading off header
+ * @param[out] result result
+ * @param s The scanner
+ * @param nv The number of vertices to be written to
+ * @param nf The number of faces
+ * @return nothing
+ */
+
+void read_off_header(CanimResult* result, OFFScanner* s, int* nv, int* nf)
+{
+    off_skip_separators(s);
+    if (s->end - s->p < 3 || strncmp(s->p, "OFF", 3) != 0)
+    {
+        *result = OFF_HEADER_OFF_ERROR;
+        return;
+    }
+    s->p += 3;
+    if (s->p < s->end && *s->p != ' ' && *s->p != '\t' && *s->p != '\r' && *s->p != '\n' && *s->p != '#')
+    {
+        *result = OFF_HEADER_OFF_ERROR;
+        return;
+    }
+    *nv = off_scan_int(result, s, OFF_HEADER_DATA_ERROR);
+    if (IS_AN_ERROR(*result))
+    {
+        return;
+    }
+    *nf = off_scan_int(result, s, OFF_HEADER_DATA_ERROR);
+    if (IS_AN_ERROR(*result))
+    {
+        return;
+    }
+    // the edge count is part of the header but nobody cares about it
+    off_skip_line(s);
+    *result = SUCCESS;
+}
+
+/**
+ * @brief Reading vertex
+ * @param[out] result result
+ * @param s The scanner
+ * @param poly The polyhedron to write to
+ * @param vertex_idx The index to write to
+ * @return nothing
+ */
+
+void read_vertex(CanimResult* result, OFFScanner* s, Polyhedron* poly, int vertex_idx)
+{
+    poly->vertices[vertex_idx].x = off_scan_float(result, s, OFF_VERTEX_ERROR);
+    if (IS_AN_ERROR(*result))
+    {
+        return;
+    }
+    poly->vertices[vertex_idx].y = off_scan_float(result, s, OFF_VERTEX_ERROR);
+    if (IS_AN_ERROR(*result))
+    {
+        return;
+    }
+    poly->vertices[vertex_idx].z = off_scan_float(result, s, OFF_VERTEX_ERROR);
+    if (IS_AN_ERROR(*result))
+    {
+        return;
+    }
+    // vertex colors and other trailing junk are ignored, like before
+    off_skip_line(s);
+    *result = SUCCESS;
+}
+
+/**
+ * @brief Reading faces
+ * @param[out] result result
+ * @param s The scanner
+ * @param poly The polyhedron to write to
+ * @param face_idx The index
+ * @return nothing
+ */
+
+void read_face(CanimResult* result, OFFScanner* s, Polyhedron* poly, int face_idx)
+{
+    int n = off_scan_int(result, s, OFF_FACE_ERROR);
+    if (IS_AN_ERROR(*result))
+    {
+        return;
+    }
+    poly->poly[face_idx].vertex_count = n;
+    poly->poly[face_idx].vertices = malloc(sizeof(int) * n);
+    if (!poly->poly[face_idx].vertices)
+    {
+        *result = POLYHEDRON_FACE_MALLOC_ERROR;
+        return;
+    }
+    for (int i = 0; i < n; i++)
+    {
+        poly->poly[face_idx].vertices[i] = off_scan_int(result, s, OFF_FACE_ERROR);
+        if (IS_AN_ERROR(*result))
+        {
+            return;
+        }
+    }
+    // optional face colors are ignored, like before
+    off_skip_line(s);
+    poly->poly[face_idx].fd.color.rgba = 0xff7f7f00 + (uint32_t)((float)face_idx*(float)0xff / ((float)poly->face_count));
+    *result = SUCCESS;
+}
+
+/**
+ * @brief Fills in the face normals of a polyhedron in one batch
+ * @param[out] result The status
+ * @param poly The polyhedron whose faces already have their indices
+ * @return nothing
+ * @remark Gathers the first three vertices of every face into contiguous
+ * arrays and runs the SIMD normal kernel over them, instead of calling
+ * normal_vec3 once per face while parsing.
+ */
+
+void compute_face_normals(CanimResult* result, Polyhedron* poly)
+{
+    int nf = poly->face_count;
+    Vec3* a = malloc(max(nf, 1) * sizeof(Vec3));
+    Vec3* b = malloc(max(nf, 1) * sizeof(Vec3));
+    Vec3* c = malloc(max(nf, 1) * sizeof(Vec3));
+    Vec3* normals = malloc(max(nf, 1) * sizeof(Vec3));
+    if (!a || !b || !c || !normals)
+    {
+        free(a);
+        free(b);
+        free(c);
+        free(normals);
+        *result = POLYHEDRON_FACE_MALLOC_ERROR;
+        return;
+    }
+    for (int i = 0; i < nf; i++)
+    {
+        a[i] = poly->vertices[poly->poly[i].vertices[0]];
+        b[i] = poly->vertices[poly->poly[i].vertices[1]];
+        c[i] = poly->vertices[poly->poly[i].vertices[2]];
+    }
+    vec3_normal_n(normals, a, b, c, nf);
+    for (int i = 0; i < nf; i++)
+    {
+        poly->poly[i].fd.normal = normals[i];
+    }
+    free(a);
+    free(b);
+    free(c);
+    free(normals);
+    *result = SUCCESS;
+}
+
+/**
+ * @brief Read OFF File and parse it into a polyhedron
+ * @param[out] result The error code
+ * @param fin
+ * @return The polyhedron
+ * @remark The whole file is slurped once and parsed with a pointer-bumping
+ * scanner; the old path went through fgets plus strtok per line, which
+ * dominated load time on million-vertex models.
+ */
+
+Polyhedron* read_off_into_polyhedron(CanimResult* result, FILE* fin)
+{
+    if (fseek(fin, 0, SEEK_END) != 0)
+    {
+        *result = OFF_READ_FILE_ERROR;
+        return null;
+    }
+    long size = ftell(fin);
+    if (size < 0 || fseek(fin, 0, SEEK_SET) != 0)
+    {
+        *result = OFF_READ_FILE_ERROR;
+        return null;
+    }
+    char* data = malloc((size_t)size + 1);
+    if (!data)
+    {
+        *result = OFF_READ_FILE_ERROR;
+        return null;
+    }
+    if (fread(data, 1, (size_t)size, fin) != (size_t)size)
+    {
+        free(data);
+        *result = OFF_READ_FILE_ERROR;
+        return null;
+    }
+    data[size] = '\0'; // strtof and strtol want a terminator
+    OFFScanner s = { data, data + size };
+
+    int nv = 0;
+    int nf = 0;
+    read_off_header(result, &s, &nv, &nf);
+    if (IS_AN_ERROR(*result))
+    {
+        free(data);
+        return null;
+    }
+    Polyhedron* poly = create_polyhedron(result, nv, nf);
+    if (IS_AN_ERROR(*result))
+    {
+        free(data);
+        return null;
+    }
+    for (int i = 0; i < nf; i++)
+    {
+        poly->poly[i].vertices = null;
     }
-    float t = ((a.x - c.x)*(c.y - d.y) - (a.y - c.y)*(c.x-d.x)) / denom;
-    float u = -((a.x - b.x)*(a.y - c.y) - (a.y - b.y)*(a.x-c.x)) / denom;
-    if (t < 0 || t > 1)
+    for (int i = 0; i < nv; i++) 
     {
-        return 0;
+        read_vertex(result, &s, poly, i);
+        if (IS_AN_ERROR(*result))
+        {
+            free_polyhedron(poly);
+            free(data);
+            return null;
+        }
     }
-    if (u < 0 || u > 1)
+    for (int i = 0; i < nf; i++)
     {
-        return 0;
+        read_face(result, &s, poly, i);
+        if (IS_AN_ERROR(*result))
+        {
+            free_polyhedron(poly);
+            free(data);
+            return null;
+        }
     }
-
-    Vec3 v1 = lerp_vec3(a, b, t);
-    Vec3 v2 = lerp_vec3(c, d, u);
-    if (fabs(v1.z - v2.z) < EPSILON)
+    free(data);
+    compute_face_normals(result, poly);
+    if (IS_AN_ERROR(*result))
     {
-        *out = lerp_vec3(v1, v2, 0.5f);
-        return 1;
+        free_polyhedron(poly);
+        return null;
     }
-    return 0;
+    return poly;
 }
 
 /**
- * @brief This generates a PSLG from a polygon
- * @param[out] result This outputs the errors
- * @param vertices These are the vertices of the polygon
- * @param vertex_count This is the number of the vertices
- * @return This outputs the PSLG (or a pointer to it but nobody asked)
+ * @brief Convert a uint32 to little-endian format
+ * @param v The number to convert
+ * @param b The new version
+ * @return nothing
  */
 
-PSLG* generate_pslg(CanimResult* result, PolygonRaw pr)
+void le32_bytes(uint32_t v, unsigned char b[4]) 
 {
-    PSLG* new = malloc(sizeof(PSLG));
-    if(!new)
-    {
-        *result = PSLG_INIT_MALLOC_ERROR;
-        return null;
-    }
-    new->vertex_count = pr.vertex_count;
-    new->edge_count = pr.vertex_count;
-    new->vertices = malloc(BIT_ALIGN(pr.vertex_count) * sizeof(Vec3));
-    if (!new->vertices) 
+    b[0] = (unsigned char)((v >> 0) & 0xFFu);
+    b[1] = (unsigned char)((v >> 8) & 0xFFu);
+    b[2] = (unsigned char)((v >> 16) & 0xFFu);
+    b[3] = (unsigned char)((v >> 24) & 0xFFu);
+}
+
+/**
+ * @brief Convert a float to little-endian format
+ * @param v The number to convert
+ * @param b The new version
+ * @return nothing
+ */
+
+void lef32_bytes(float v, unsigned char b[4]) 
+{
+    le32_bytes(*(uint32_t*)&v, b);
+}
+
+/// @def STL_RECORD_SIZE
+/// @brief Bytes per binary stl triangle record (4 vectors and the attribute)
+#define STL_RECORD_SIZE 50
+
+/// @def STL_BATCH_TRIANGLES
+/// @brief Triangles serialized per fwrite; about 3 MiB of records
+#define STL_BATCH_TRIANGLES 65536
+
+/**
+ * @brief Packs a Vec3 as three little-endian floats
+ * @param p Where the 12 bytes go
+ * @param v The vector
+ * @return nothing
+ */
+
+static void stl_pack_vec3(unsigned char* p, Vec3 v)
+{
+    lef32_bytes(v.x, p);
+    lef32_bytes(v.y, p + 4);
+    lef32_bytes(v.z, p + 8);
+}
+
+/**
+ * @brief Serializes one batch of gathered triangles and flushes it
+ * @param[out] result The status
+ * @param fin The file
+ * @param a The first vertices
+ * @param b The second vertices
+ * @param c The third vertices
+ * @param normals Scratch for the batch normals (overwritten)
+ * @param block Scratch for the serialized records (overwritten)
+ * @param count How many triangles this batch holds
+ * @return nothing
+ * @remark Normals come from the batch Vec3 kernels, and the whole batch
+ * lands in a single fwrite instead of one syscall per vector.
+ */
+
+static void flush_stl_batch(CanimResult* result, FILE* fin, const Vec3* a, const Vec3* b, const Vec3* c, Vec3* normals, unsigned char* block, int count)
+{
+    vec3_normal_n(normals, a, b, c, count);
+    unsigned char* p = block;
+    for (int i = 0; i < count; i++)
     {
-        new->vertex_count = 0;
-        new->edge_count = 0;
-        new->edges = null;
-        *result = PSLG_VERTEX_MALLOC_ERROR;
-        return null;
+        stl_pack_vec3(p, normals[i]);
+        stl_pack_vec3(p + 12, a[i]);
+        stl_pack_vec3(p + 24, b[i]);
+        stl_pack_vec3(p + 36, c[i]);
+        p[48] = 0;
+        p[49] = 0;
+        p += STL_RECORD_SIZE;
     }
-    for (int i = 0; i < pr.vertex_count; i++)
+    if (fwrite(block, STL_RECORD_SIZE, count, fin) != (size_t)count)
     {
-        new->vertices[i] = pr.vertices[i];
+        *result = STL_VECTOR_WRITE_ERROR;
+        return;
     }
+    *result = SUCCESS;
+}
+
+/**
+ * @brief Writes the stl header and triangle count
+ * @param[out] result The status
+ * @param fin The file
+ * @param triangle_count The number of triangles that will follow
+ * @return nothing
+ */
 
-    new->edges = malloc(BIT_ALIGN(new->edge_count) * sizeof(int[2]));
-    if (!new->edges) 
+void write_stl_header(CanimResult* result, FILE* fin, int triangle_count)
+{
+    unsigned char header[80];
+    memset(header, 0, sizeof(header));
+    if(fwrite(header, 1, 80, fin) != 80)
     {
-        free(new->vertices);
-        new->vertex_count = 0;
-        new->edge_count = 0;
-        *result = PSLG_EDGE_MALLOC_ERROR;
-        return null;
+        *result = STL_HEADER_WRITE_ERROR;
+        return;
     }
-
-    for (int i = 0; i < pr.vertex_count; i++)
+    unsigned char h[4];
+    le32_bytes((uint32_t)triangle_count, h);
+    if(fwrite(h, 1, 4, fin) != 4)
     {
-        new->edges[i][0] = i;
-        new->edges[i][1] = (i + 1) % pr.vertex_count; 
+        *result = STL_HEADER_WRITE_ERROR;
+        return;
     }
-    new->poly = pr;
     *result = SUCCESS;
-    return new;
 }
 
 /**
- * @brief Deduplicates the pslg
+ * @brief Writes a triangulation into an stl
  * @param[out] result
- * @param pslg the pslg
- * @param v1 the first vertex
- * @param v2 the second vertex
+ * @param tri The triangulation
+ * @param file The file
  * @return nothing
+ * @remark Batched: triangles are gathered STL_BATCH_TRIANGLES at a time,
+ * normals come from the batch kernels, and each batch is one fwrite.
  */
 
-void dedup_pslg_a_vertex(CanimResult* result, PSLG* pslg, int v1, int v2)
+void write_to_stl(CanimResult* result, Triangulation* tri, FILE* fin)
 {
-    if (v1 == v2)
+    write_stl_header(result, fin, tri->triangle_count);
+    if (IS_AN_ERROR(*result))
     {
-        *result = NOOP;
         return;
     }
-    if (v1 > v2)
+    int batch = tri->triangle_count < STL_BATCH_TRIANGLES ? tri->triangle_count : STL_BATCH_TRIANGLES;
+    if (batch < 1)
     {
-        *result = NOOP;
+        *result = SUCCESS;
         return;
     }
-    Vec3 vec1 = pslg->vertices[v1];
-    Vec3 vec2 = pslg->vertices[v2]; 
-    if (!equal_vec3(vec1, vec2))
+    Vec3* a = malloc(4 * batch * sizeof(Vec3));
+    unsigned char* block = malloc((size_t)batch * STL_RECORD_SIZE);
+    if (!a || !block)
     {
-        *result = NOOP;
+        free(a);
+        free(block);
+        *result = STL_BATCH_MALLOC_ERROR;
         return;
-    }    
-    for (int i = v2; i < pslg->vertex_count - 1; i++)
-    {
-        pslg->vertices[i] = pslg->vertices[i + 1];
-    }
-    if (REALIGN(pslg->vertex_count, pslg->vertex_count - 1))
-    {
-        Vec3* temp = realloc(pslg->vertices, BIT_ALIGN(pslg->vertex_count - 1) * sizeof(Vec3));
-        if (!temp)
-        {
-            *result = DEDUP_PSLG_VERTEX_REALLOC_ERROR;
-            return;
-        }
-        pslg->vertices = temp;
     }
-    pslg->vertex_count--;
-    for (int i = 0; i < pslg->edge_count; i++)
+    Vec3* b = a + batch;
+    Vec3* c = b + batch;
+    Vec3* normals = c + batch;
+    for (int start = 0; start < tri->triangle_count; start += batch)
     {
-        if (pslg->edges[i][0] == v2)
-        {
-            pslg->edges[i][0] = v1;
-        }
-        if (pslg->edges[i][1] == v2)
-        {
-            pslg->edges[i][1] = v1;
-        }
-        if (pslg->edges[i][0] > v2)
+        int count = tri->triangle_count - start;
+        count = count < batch ? count : batch;
+        for (int i = 0; i < count; i++)
         {
-            pslg->edges[i][0]--;
+            a[i] = tri->triangles[start + i].vertices[0];
+            b[i] = tri->triangles[start + i].vertices[1];
+            c[i] = tri->triangles[start + i].vertices[2];
         }
-        if (pslg->edges[i][1] > v2)
+        flush_stl_batch(result, fin, a, b, c, normals, block, count);
+        if (IS_AN_ERROR(*result))
         {
-            pslg->edges[i][1]--;
+            free(a);
+            free(block);
+            return;
         }
     }
+    free(a);
+    free(block);
     *result = SUCCESS;
 }
 
 /**
- * @brief This deduplicates a single vertex
- * @param[out] result This outputs the result
- * @param pslg This deduplicates a single vertex
+ * @brief Writes an indexed triangulation into an stl
+ * @param[out] result The status
+ * @param itri The indexed triangulation
+ * @param fin The file
  * @return nothing
+ * @remark Consumes the shared vertex pool directly, no detour through a
+ * raw triangulation, and flushes STL_BATCH_TRIANGLES records per fwrite.
  */
 
-void dedup_pslg_one_vertex(CanimResult* result, PSLG* pslg)
+void write_indexed_to_stl(CanimResult* result, IndexedTriangulation* itri, FILE* fin)
 {
-    for (int i = 0; i < pslg->vertex_count; i++)
+    write_stl_header(result, fin, itri->triangle_count);
+    if (IS_AN_ERROR(*result))
+    {
+        return;
+    }
+    int batch = itri->triangle_count < STL_BATCH_TRIANGLES ? itri->triangle_count : STL_BATCH_TRIANGLES;
+    if (batch < 1)
+    {
+        *result = SUCCESS;
+        return;
+    }
+    Vec3* a = malloc(4 * batch * sizeof(Vec3));
+    unsigned char* block = malloc((size_t)batch * STL_RECORD_SIZE);
+    if (!a || !block)
+    {
+        free(a);
+        free(block);
+        *result = STL_BATCH_MALLOC_ERROR;
+        return;
+    }
+    Vec3* b = a + batch;
+    Vec3* c = b + batch;
+    Vec3* normals = c + batch;
+    for (int start = 0; start < itri->triangle_count; start += batch)
     {
-        for (int j = 0; j < pslg->vertex_count; j++)
+        int count = itri->triangle_count - start;
+        count = count < batch ? count : batch;
+        for (int i = 0; i < count; i++)
         {
-            dedup_pslg_a_vertex(result, pslg, i, j);
-            if (*result != NOOP)
-            {
-                return;
-            }
+            a[i] = itri->vertices[itri->triangles[start + i].vertices[0]];
+            b[i] = itri->vertices[itri->triangles[start + i].vertices[1]];
+            c[i] = itri->vertices[itri->triangles[start + i].vertices[2]];
+        }
+        flush_stl_batch(result, fin, a, b, c, normals, block, count);
+        if (IS_AN_ERROR(*result))
+        {
+            free(a);
+            free(block);
+            return;
         }
     }
-    *result = NOOP;
+    free(a);
+    free(block);
+    *result = SUCCESS;
 }
 
+/// @def TRI_CACHE_MAGIC
+/// @brief "CANIMTRI" as a little-endian u64, the cache file signature.
+#define TRI_CACHE_MAGIC 0x4952544D494E4143ull
+
+/// @def TRI_CACHE_VERSION
+/// @brief Bump this whenever TriangleRaw or the header layout changes.
+#define TRI_CACHE_VERSION 1u
+
 /**
- * @brief This deduplicates all vertices
- * @param[out] result This outputs result
- * @param pslg The pslg
- * @return nothing
+ * @brief FNV-1a hash of a whole file
+ * @param[out] result The status
+ * @param path The file to hash
+ * @return The 64 bit hash (0 on error)
  */
 
-void dedup_pslg_vertex(CanimResult* result, PSLG* pslg)
+uint64_t hash_file_contents(CanimResult* result, const char* path)
 {
-    for(;;)
+    FILE* f = fopen(path, "rb");
+    if (!f)
     {
-        dedup_pslg_one_vertex(result, pslg);
-        if (*result == NOOP)
-        {
-            return;
-        }
-        if (IS_AN_ERROR(*result))
+        *result = OFF_READ_FILE_ERROR;
+        return 0;
+    }
+    uint64_t h = 0xcbf29ce484222325ull;
+    unsigned char buf[BUFFER_SIZE];
+    size_t n;
+    for (;(n = fread(buf, 1, sizeof(buf), f)) > 0;)
+    {
+        for (size_t i = 0; i < n; i++)
         {
-            return;
+            h ^= buf[i];
+            h *= 0x100000001b3ull;
         }
     }
+    if (ferror(f))
+    {
+        fclose(f);
+        *result = OFF_READ_FILE_ERROR;
+        return 0;
+    }
+    fclose(f);
+    *result = SUCCESS;
+    return h;
 }
 
-/** 
- * @brief Deduplicates a single edge
- * @param[out] result This outputs result
- * @param pslg The pslg
- * @param e1 The first edge
- * @param e2 The second edge
- * @return Nothing
+/**
+ * @brief Tries to load a cached triangulation for a given source hash
+ * @param[out] result The status (NOOP on a cache miss of any kind)
+ * @param path The cache file path
+ * @param off_hash The content hash of the source off file
+ * @return The triangulation, or null on a miss
+ * @remark A missing, truncated, stale, or otherwise suspicious cache file
+ * is simply a miss; the caller re-triangulates and overwrites it.
  */
 
-void dedup_pslg_a_edge(CanimResult* result, PSLG* pslg, int e1, int e2)
+Triangulation* load_triangulation_cache(CanimResult* result, const char* path, uint64_t off_hash)
 {
-    if (e1 > e2)
+    FILE* f = fopen(path, "rb");
+    if (!f)
     {
         *result = NOOP;
-        return;
+        return null;
     }
-    if (e1 == e2)
+    uint64_t magic = 0;
+    uint32_t version = 0;
+    uint64_t hash = 0;
+    uint32_t count = 0;
+    if (
+        fread(&magic, sizeof(magic), 1, f) != 1 ||
+        fread(&version, sizeof(version), 1, f) != 1 ||
+        fread(&hash, sizeof(hash), 1, f) != 1 ||
+        fread(&count, sizeof(count), 1, f) != 1 ||
+        magic != TRI_CACHE_MAGIC ||
+        version != TRI_CACHE_VERSION ||
+        hash != off_hash
+    )
     {
+        fclose(f);
         *result = NOOP;
-        return;
+        return null;
     }
-    
-    bool b = false;
-
-    if (equal_vec3(pslg->vertices[pslg->edges[e1][0]], pslg->vertices[pslg->edges[e2][0]]))
+    Triangulation* tri = empty_triangulation(result);
+    if (IS_AN_ERROR(*result))
     {
-        if (equal_vec3(pslg->vertices[pslg->edges[e1][1]], pslg->vertices[pslg->edges[e2][1]]))
-        {
-            b = true;
-        }
+        fclose(f);
+        return null;
     }
-
-    if (equal_vec3(pslg->vertices[pslg->edges[e1][0]], pslg->vertices[pslg->edges[e2][1]]))
+    reserve_triangulation(result, tri, (int)count);
+    if (IS_AN_ERROR(*result))
     {
-        if (equal_vec3(pslg->vertices[pslg->edges[e1][1]], pslg->vertices[pslg->edges[e2][0]]))
-        {
-            b = true;
-        }
+        free_triangulation(tri);
+        fclose(f);
+        *result = TRI_CACHE_READ_ERROR;
+        return null;
     }
-    
-    if(!b)
+    if (fread(tri->triangles, sizeof(TriangleRaw), count, f) != count)
     {
+        free_triangulation(tri);
+        fclose(f);
         *result = NOOP;
-        return;
+        return null;
     }
+    fclose(f);
+    tri->triangle_count = (int)count;
+    *result = SUCCESS;
+    return tri;
+}
 
-    
-    for (int i = e2; i < pslg->edge_count - 1; i++)
+/**
+ * @brief Writes a triangulation cache next to the source model
+ * @param[out] result The status (TRI_CACHE_WRITE_ERROR is nonfatal)
+ * @param path The cache file path
+ * @param off_hash The content hash of the source off file
+ * @param tri The triangulation to serialize
+ * @return nothing
+ */
+
+void save_triangulation_cache(CanimResult* result, const char* path, uint64_t off_hash, Triangulation* tri)
+{
+    FILE* f = fopen(path, "wb");
+    if (!f)
     {
-        pslg->edges[i][0] = pslg->edges[i + 1][0];
-        pslg->edges[i][1] = pslg->edges[i + 1][1];
+        *result = TRI_CACHE_WRITE_ERROR;
+        return;
     }
-
-    if (REALIGN(pslg->edge_count, pslg->edge_count-1))
+    uint64_t magic = TRI_CACHE_MAGIC;
+    uint32_t version = TRI_CACHE_VERSION;
+    uint32_t count = (uint32_t)tri->triangle_count;
+    if (
+        fwrite(&magic, sizeof(magic), 1, f) != 1 ||
+        fwrite(&version, sizeof(version), 1, f) != 1 ||
+        fwrite(&off_hash, sizeof(off_hash), 1, f) != 1 ||
+        fwrite(&count, sizeof(count), 1, f) != 1 ||
+        fwrite(tri->triangles, sizeof(TriangleRaw), count, f) != count
+    )
     {
-        int (*temp_ptr)[2] = realloc(pslg->edges, sizeof(int[2]) * BIT_ALIGN(pslg->edge_count - 1));
-        if (!temp_ptr)
-        {
-            *result = DEDUP_PSLG_EDGES_REALLOC_ERROR;
-            return;
-        }
-
-        pslg->edges = temp_ptr;
+        fclose(f);
+        remove(path); // don't leave a half-written cache around
+        *result = TRI_CACHE_WRITE_ERROR;
+        return;
     }
+    fclose(f);
     *result = SUCCESS;
-    pslg->edge_count--;
 }
 
+/// @def TRI_VERTEX_SIZE
+/// @brief Bytes per interleaved vertex (pos, normal, packed rgba)
+#define TRI_VERTEX_SIZE 28
+
 /**
- * @brief Deduplicates the pslg, only one edge
- * @param[out] result The result
- * @param pslg The PSLG to be deduplicated
+ * @brief Packs one triangle into three interleaved 28-byte vertices
+ * @param p Where the 84 bytes go
+ * @param t The triangle
  * @return nothing
  */
 
-void dedup_pslg_one_edge(CanimResult* result, PSLG* pslg)
+static void pack_triangle_vertices(uint8_t* p, const TriangleRaw* t)
 {
-    for (int i = 0; i < pslg->edge_count; i++)
+    Vec3 n = t->fd.normal;
+    uint32_t col = t->fd.color.rgba;
+    for (int v = 0; v < 3; v++)
+    {
+        *(float*)(p + 0)  = t->vertices[v].x;
+        *(float*)(p + 4)  = t->vertices[v].y;
+        *(float*)(p + 8)  = t->vertices[v].z;
+        *(float*)(p + 12) = n.x;
+        *(float*)(p + 16) = n.y;
+        *(float*)(p + 20) = n.z;
+        *(uint32_t*)(p + 24) = col;
+        p += TRI_VERTEX_SIZE;
+    }
+}
+
+/**
+ * @brief Widens the dirty range to cover some triangles
+ * @param tri The triangulation
+ * @param first The first changed triangle
+ * @param count How many changed
+ * @return nothing
+ */
+
+void mark_triangulation_dirty(Triangulation* tri, int first, int count)
+{
+    if (count <= 0)
     {
-        for (int j = 0; j < pslg->edge_count; j++)
-        {
-            dedup_pslg_a_edge(result, pslg, i, j);
-            if (*result != NOOP)
-            {
-                return;
-            }
-        }
+        return;
+    }
+    if (tri->gpu.dirty_max <= tri->gpu.dirty_min)
+    {
+        tri->gpu.dirty_min = first;
+        tri->gpu.dirty_max = first + count;
+        return;
+    }
+    if (first < tri->gpu.dirty_min)
+    {
+        tri->gpu.dirty_min = first;
+    }
+    if (first + count > tri->gpu.dirty_max)
+    {
+        tri->gpu.dirty_max = first + count;
     }
-    *result = NOOP;
 }
 
 /**
- * @brief Deduplicates the pslg edges
- * @param[out] result The result
- * @param pslg The PSLG to be deduplicated
+ * @brief Moves one triangle's vertices and fixes its normal
+ * @param[out] result The status
+ * @param tri The triangulation
+ * @param index Which triangle
+ * @param a The new first vertex
+ * @param b The new second one
+ * @param c The new third one
  * @return nothing
+ * @remark This is the mutation path animations should use: it keeps the
+ * vbo alive and just widens the dirty range, so the next draw re-uploads
+ * only the touched bytes instead of rebuilding everything.
  */
 
-void dedup_pslg_edge(CanimResult* result, PSLG* pslg)
+void set_triangle_vertices(CanimResult* result, Triangulation* tri, int index, Vec3 a, Vec3 b, Vec3 c)
 {
-    for(;;)
+    if (index < 0 || index >= tri->triangle_count)
     {
-        dedup_pslg_one_edge(result, pslg);
-        if (*result == NOOP)
-        {
-            return;
-        }
-        if (IS_AN_ERROR(*result))
-        {
-            return;
-        }
+        *result = NOOP;
+        return;
     }
+    tri->triangles[index].vertices[0] = a;
+    tri->triangles[index].vertices[1] = b;
+    tri->triangles[index].vertices[2] = c;
+    tri->triangles[index].fd.normal = normal_vec3(a, b, c);
+    mark_triangulation_dirty(tri, index, 1);
+    *result = SUCCESS;
 }
 
 /**
- * @brief Deduplicates the entire pslg
- * @param[out] result The result
- * @param pslg The pslg to be deduplicated
+ * @brief Morphs a triangulation between two endpoint triangulations
+ * @param[out] result The status
+ * @param tri The triangulation being animated (same layout as the endpoints)
+ * @param from The t=0 shape
+ * @param to The t=1 shape
+ * @param t The blend factor
  * @return nothing
+ * @remark Triangles that are identical in both endpoints are skipped
+ * entirely (no lerp, no normal, no upload), so a morph touching 5% of
+ * the mesh costs 5% of a rebuild.
  */
 
-void dedup_pslg(CanimResult* result, PSLG* pslg)
+void morph_triangulation(CanimResult* result, Triangulation* tri, const Triangulation* from, const Triangulation* to, float t)
 {
-    dedup_pslg_vertex(result, pslg);
-    if (IS_AN_ERROR(*result))
+    if (tri->triangle_count != from->triangle_count || tri->triangle_count != to->triangle_count)
     {
+        *result = MORPH_TRIANGULATION_MISMATCH_ERROR;
         return;
     }
-    dedup_pslg_edge(result, pslg);
-    if (IS_AN_ERROR(*result))
+    for (int i = 0; i < tri->triangle_count; i++)
     {
-        return;
+        const TriangleRaw* f = &from->triangles[i];
+        const TriangleRaw* g = &to->triangles[i];
+        if (memcmp(f->vertices, g->vertices, sizeof(f->vertices)) == 0)
+        {
+            continue;
+        }
+        Vec3 a = lerp_vec3(f->vertices[0], g->vertices[0], t);
+        Vec3 b = lerp_vec3(f->vertices[1], g->vertices[1], t);
+        Vec3 c = lerp_vec3(f->vertices[2], g->vertices[2], t);
+        set_triangle_vertices(result, tri, i, a, b, c);
     }
     *result = SUCCESS;
 }
 
 /**
- * @brief This takes two edges and splits a PSLG if neccesary
- * @param[out] result This outputs the errors and status
- * @param pslg This is the input pslg
- * @param edge1 This is the first edge
- * @param edge2 This is the second edge
- * @return This outputs nothing. 
+ * @brief Uploads a triangulation into its cached GPU buffers.
+ * @param[out] result If any fail occured.
+ * @param prog The shader program (with "position" and "normal" attributes).
+ * @param tri  The triangulation to upload.
+ * @return nothing
+ * @remark This is the slow half of drawing: it rebuilds the interleaved
+ * vertex buffer and reuploads it. It only needs to run after the
+ * triangulation grew or shrank (add_triangle clears tri->gpu.uploaded);
+ * in-place mutations go through the dirty range instead.
  */
-
-
-void splitPSLG(CanimResult* result, PSLG* pslg, int edge1, int edge2)
+void upload_triangulation(CanimResult* result, GLuint prog, Triangulation* tri)
 {
-    Vec3 out;
-    if
-    (
-        pslg->edges[edge1][0] == pslg->edges[edge2][0] ||
-        pslg->edges[edge1][0] == pslg->edges[edge2][1] ||
-        pslg->edges[edge1][1] == pslg->edges[edge2][0] ||
-        pslg->edges[edge1][1] == pslg->edges[edge2][1]
-    )
+    const size_t total_bytes = tri->triangle_count * 3 * (size_t)TRI_VERTEX_SIZE;
+
+    uint8_t* data = malloc(total_bytes);
+    if (!data)
     {
-        *result = NOOP;
+        *result = DRAW_TRIANGULATION_MALLOC_ERROR;
         return;
     }
 
-    Vec3 v1 = pslg->vertices[pslg->edges[edge1][0]];
-    Vec3 v2 = pslg->vertices[pslg->edges[edge1][1]];
-    Vec3 v3 = pslg->vertices[pslg->edges[edge2][0]];
-    Vec3 v4 = pslg->vertices[pslg->edges[edge2][1]];
-    int intersection = 
-        intersecting_segments(
-            v1,
-            v2,
-            v3,
-            v4,
-            &out
-        );
-    if (intersection == 0)
+    for (int i = 0; i < tri->triangle_count; i++)
     {
-        *result = NOOP;
-        return;
+        pack_triangle_vertices(data + (size_t)i * 3 * TRI_VERTEX_SIZE, &tri->triangles[i]);
     }
 
-    if (REALIGN(pslg->vertex_count, pslg->vertex_count + 1))
+    if (!tri->gpu.vao)
     {
-        Vec3* temp_ptr = realloc(pslg->vertices, sizeof(Vec3) * BIT_ALIGN(pslg->vertex_count + 1));
-        if (temp_ptr == null)
-        {
-            *result = PSLG_EDGE_SPLIT_VERTEX_REALLOC_ERROR;
-            return;
-        }
-        pslg->vertices = temp_ptr;  
+        pglGenVertexArrays(1, &tri->gpu.vao);
     }
-    if (REALIGN(pslg->edge_count, pslg->edge_count + 2))
+    pglBindVertexArray(tri->gpu.vao);
+
+    if (!tri->gpu.vbo)
     {
-        int (*temp_ptr)[2] = realloc(pslg->edges, sizeof(int[2]) * BIT_ALIGN(pslg->edge_count + 2));
-        if (temp_ptr == null)
-        {
-            *result = PSLG_EDGE_SPLIT_EDGE_REALLOC_ERROR;
-            return;
-        }
-        pslg->edges = temp_ptr;
+        pglGenBuffers(1, &tri->gpu.vbo);
     }
-    pslg->vertices[pslg->vertex_count] = out;
-    pslg->edges[pslg->edge_count][0] = pslg->edges[edge1][1];
-    pslg->edges[pslg->edge_count][1] = pslg->vertex_count;
-    pslg->edges[pslg->edge_count+1][0] = pslg->edges[edge2][1];
-    pslg->edges[pslg->edge_count+1][1] = pslg->vertex_count;
-    pslg->edges[edge1][1] = pslg->vertex_count;
-    pslg->edges[edge2][1] = pslg->vertex_count;
-    pslg->edge_count+=2;
-    pslg->vertex_count+=1;
+    pglBindBuffer(GL_ARRAY_BUFFER, tri->gpu.vbo);
+    pglBufferData(GL_ARRAY_BUFFER, total_bytes, data, GL_STATIC_DRAW);
+    free(data);
+
+    GLint posLoc   = pglGetAttribLocation(prog, "position");
+    GLint normLoc  = pglGetAttribLocation(prog, "normal");
+    GLint colorLoc = pglGetAttribLocation(prog, "color");
+
+    if (posLoc >= 0)
+    {
+        pglEnableVertexAttribArray(posLoc);
+        pglVertexAttribPointer(posLoc, 3, GL_FLOAT, GL_FALSE, 28, (void*)0);
+    }
+    if (normLoc >= 0)
+    {
+        pglEnableVertexAttribArray(normLoc);
+        pglVertexAttribPointer(normLoc, 3, GL_FLOAT, GL_FALSE, 28, (void*)12);
+    }
+    if (colorLoc >= 0)
+    {
+        pglEnableVertexAttribArray(colorLoc);
+        pglVertexAttribPointer(colorLoc, 4, GL_UNSIGNED_BYTE, GL_TRUE, 28, (void*)24);
+    }
+
+    pglBindVertexArray(0);
+    tri->gpu.uploaded_count = tri->triangle_count;
+    tri->gpu.uploaded = true;
+    tri->gpu.dirty_min = 0;
+    tri->gpu.dirty_max = 0; // a full upload clears any dirty range
     *result = SUCCESS;
 }
 
 /**
- * @brief This removes a single edge
- * @param[out] result This is the status
- * @param pslg This is the PSLG that needs an edge to be removed 
- * @return This outputs nothing 
+ * @brief Re-uploads just the dirty byte range of the vbo
+ * @param[out] result If any fail occured.
+ * @param tri The triangulation (must be uploaded already)
+ * @return nothing
  */
 
-void remove_single_edge(CanimResult* result, PSLG* pslg)
+static void upload_triangulation_dirty(CanimResult* result, Triangulation* tri)
 {
-    for(int i = 0; i < pslg->edge_count; i++)
+    int first = tri->gpu.dirty_min;
+    int count = tri->gpu.dirty_max - tri->gpu.dirty_min;
+    size_t tri_bytes = 3 * (size_t)TRI_VERTEX_SIZE;
+    uint8_t* data = malloc(count * tri_bytes);
+    if (!data)
     {
-        for(int j = 0; j < pslg->edge_count; j++)
-        {
-            splitPSLG(result, pslg, i, j);
-            if(*result != NOOP)
-            {
-                return;
-            }
-        }
+        *result = DRAW_TRIANGULATION_MALLOC_ERROR;
+        return;
     }
-    *result = NOOP;
+    for (int i = 0; i < count; i++)
+    {
+        pack_triangle_vertices(data + (size_t)i * tri_bytes, &tri->triangles[first + i]);
+    }
+    pglBindBuffer(GL_ARRAY_BUFFER, tri->gpu.vbo);
+    pglBufferSubData(GL_ARRAY_BUFFER, first * tri_bytes, count * tri_bytes, data);
+    pglBindBuffer(GL_ARRAY_BUFFER, 0);
+    free(data);
+    tri->gpu.dirty_min = 0;
+    tri->gpu.dirty_max = 0;
+    *result = SUCCESS;
 }
 
 /**
- * @brief This splits it entirely
- * @param[out] result The status
- * @param pslg The pslg that need be split
- * @return This outputs nothing 
+ * @brief Draws a triangulation, uploading it first only if it changed.
+ * @param[out] result If any fail occured.
+ * @param prog The shader program (with "position" and "normal" attributes).
+ * @param tri  The triangulation to draw.
+ * @remark The steady-state cost is a vao bind plus one glDrawArrays; the
+ * interleaved buffer is not rebuilt per frame anymore, and in-place
+ * mutations (morphs) only re-upload their dirty byte range.
  */
-
-void split_entirely(CanimResult* result, PSLG* pslg)
+void draw_triangulation(CanimResult* result, GLuint prog, Triangulation* tri)
 {
-    for(;;)
+    if (!tri->gpu.uploaded)
     {
-        int ne = pslg->edge_count;
-        int nv = pslg->vertex_count;
-        remove_single_edge(result, pslg);
-    
-        if(*result == NOOP) 
-        {
-            *result = SUCCESS;
-            return;
-        }
-        if(IS_AN_ERROR(*result))
+        upload_triangulation(result, prog, tri);
+        if (IS_AN_ERROR(*result))
         {
             return;
         }
-        dedup_pslg(result, pslg);
-        if(IS_AN_ERROR(*result))
+    }
+    else if (tri->gpu.dirty_max > tri->gpu.dirty_min)
+    {
+        upload_triangulation_dirty(result, tri);
+        if (IS_AN_ERROR(*result))
         {
             return;
         }
-        
-        if (pslg->edge_count == ne)
-        {
-            if (pslg->vertex_count == nv)
-            {
-                return;
-            }
-        }
     }
+
+    pglBindVertexArray(tri->gpu.vao);
+    pglUseProgram(prog);
+    glDrawArrays(GL_TRIANGLES, 0, tri->gpu.uploaded_count * 3);
+    pglBindVertexArray(0);
+    *result = SUCCESS;
 }
 
 /**
- * @brief This frees a pslg
- * @param pslg This is the PSLG that need be freed.
+ * @brief One instance of a triangulation: a model matrix and a tint
+ * @remark This is the exact byte layout the instance vbo holds, so an
+ * array of these uploads with one glBufferSubData.
  */
 
-void free_pslg(PSLG* pslg)
+typedef struct
 {
-    // if this function fails that would funny lol, but that isn't happening
-    free(pslg->edges);
-    free(pslg->vertices);
-    free(pslg);
+    /**
+     *  @brief The model matrix (column-major, like every mat4 here)
+     *  */
+    float transform[16];
+    /**
+     *  @brief The color tint (multiplied into the vertex colors)
+     *  */
+    Color tint;
 }
+TriangulationInstance;
 
 /**
- * @brief This takes a pslg and makes an empty triangulation and merges them
- * @param[out] result This is the status
- * @param pslg This is the pslg that we use to construct the PSLGTriangulation
- * @return This is the resulting PSLGTriangulation
+ * @brief Builds an instance from a pose, a scale, and a tint
+ * @param position Where the copy goes
+ * @param orientation How it's turned
+ * @param scale How big it is
+ * @param tint The color tint (white for none)
+ * @return The instance
  */
 
-PSLGTriangulation* create_pslg_triangulation(CanimResult* result, PSLG* pslg)
+TriangulationInstance make_triangulation_instance(Vec3 position, Quaternion orientation, float scale, Color tint)
 {
-    PSLGTriangulation* pslgtri = malloc(sizeof(PSLGTriangulation));
-    if (!pslgtri)
-    {
-        *result = PSLG_TRIANGULATION_INIT_MALLOC_ERROR;
-        return null;
-    }
-    pslgtri->triangulation = empty_triangulation(result);
-    if (IS_AN_ERROR(*result))
+    TriangulationInstance inst;
+    mat4_from_quat(inst.transform, orientation);
+    for (int i = 0; i < 12; i++)
     {
-        free(pslgtri);
-        return null;
+        inst.transform[i] *= scale;
     }
-    pslgtri->pslg = pslg;
-    *result = SUCCESS;
-    return pslgtri;
+    inst.transform[12] = position.x;
+    inst.transform[13] = position.y;
+    inst.transform[14] = position.z;
+    inst.tint = tint;
+    return inst;
 }
 
 /**
- * @brief This attacks a vertex
- * @param[out] result This is the status
- * @param pslgtri The PSLGTriangulation that has the vertex to be attacked
- * @param vertex_idx The index of the vertex
- * @return Nothing
+ * @brief Draws many copies of one triangulation in a single call.
+ * @param[out] result If any fail occured.
+ * @param prog The instanced shader program (triangulation_instanced_vs).
+ * @param tri The triangulation (uploaded once, shared by every copy).
+ * @param instances The per-instance transforms and tints.
+ * @param instance_count How many copies to draw.
+ * @return nothing
+ * @remark The geometry vbo is untouched; only the small instance buffer
+ * streams per call, so an N-copy scene costs one upload plus
+ * N * sizeof(TriangulationInstance) bytes instead of N full rebuilds.
  */
 
-void attack_vertex(CanimResult* result, PSLGTriangulation* pslgtri, int vertex_idx)
-{   
-    PSLG* pslg = pslgtri->pslg;
-    Triangulation* tri = pslgtri->triangulation;
-    int d = 0;
-    int e1;
-    int e2;
-    for(int i = 0; i < pslg->edge_count; i++)
-    {
-        if
-        (
-            pslg->edges[i][0] == vertex_idx ||
-            pslg->edges[i][1] == vertex_idx
-        )
-        {
-            d++;
-            if (d > 2)
-            {
-                *result = NOOP;
-                return;
-            }
-            if (d > 1)
-            {
-                e2 = i;
-            }
-            else
-            {
-                e1 = i;
-            }
-        }
-    }
-    if (d != 2)
+void draw_triangulation_instanced(CanimResult* result, GLuint prog, Triangulation* tri, const TriangulationInstance* instances, int instance_count)
+{
+    if (instance_count <= 0)
     {
         *result = NOOP;
         return;
     }
-    int v1 = pslg->edges[e1][0];
-    int v2 = pslg->edges[e2][0];
-    int v3 = pslg->edges[e2][1];
-    if (v1 == vertex_idx)
+    if (!tri->gpu.uploaded)
     {
-        v1 = pslg->edges[e1][1];
+        upload_triangulation(result, prog, tri);
+        if (IS_AN_ERROR(*result))
+        {
+            return;
+        }
     }
-    if (v2 == vertex_idx)
+
+    pglBindVertexArray(tri->gpu.vao);
+    if (!tri->gpu.instance_vbo)
     {
-        v2 = pslg->edges[e2][1];
-        v3 = pslg->edges[e2][0];
+        pglGenBuffers(1, &tri->gpu.instance_vbo);
     }
-    TriangleRaw tr;
-    tr.fd = pslgtri->pslg->poly.fd;
-    tr.vertices[0] = pslg->vertices[v1];
-    tr.vertices[1] = pslg->vertices[v2];
-    tr.vertices[2] = pslg->vertices[v3];
-    add_triangle(result, tri, tr);
-    if (IS_AN_ERROR(*result))
+    pglBindBuffer(GL_ARRAY_BUFFER, tri->gpu.instance_vbo);
+    if (instance_count > tri->gpu.instance_capacity)
     {
-        return;
+        // orphan and regrow in the usual power-of-two steps
+        tri->gpu.instance_capacity = BIT_ALIGN(instance_count);
+        pglBufferData(GL_ARRAY_BUFFER, tri->gpu.instance_capacity * sizeof(TriangulationInstance), null, GL_STREAM_DRAW);
     }
-    int e3_exists = 0;
-    for(int i = 0; i < pslg->edge_count; i++)
+    pglBufferSubData(GL_ARRAY_BUFFER, 0, instance_count * sizeof(TriangulationInstance), instances);
+
+    // a mat4 attribute is really four vec4 columns, each with divisor 1
+    const char* col_names[4] = { "inst_col0", "inst_col1", "inst_col2", "inst_col3" };
+    for (int c = 0; c < 4; c++)
     {
-        if
-        (
-            (pslg->edges[i][0] == v1 && pslg->edges[i][1] == v2) ||
-            (pslg->edges[i][0] == v2 && pslg->edges[i][1] == v1)
-        )
-        {   
-            e3_exists = 1;
-            break;
+        GLint loc = pglGetAttribLocation(prog, col_names[c]);
+        if (loc >= 0)
+        {
+            pglEnableVertexAttribArray(loc);
+            pglVertexAttribPointer(loc, 4, GL_FLOAT, GL_FALSE, sizeof(TriangulationInstance), (void*)(size_t)(c * 4 * sizeof(float)));
+            pglVertexAttribDivisor(loc, 1);
         }
     }
-    int ecount = e3_exists ? pslg->edge_count - 2 : pslg->edge_count - 1;
-    int (*temp)[2] = malloc(ecount * sizeof(int[2])); // this isn't aligned because it is gonna DIE SOON.
-    if (temp == null)
+    GLint tintLoc = pglGetAttribLocation(prog, "inst_tint");
+    if (tintLoc >= 0)
     {
+        pglEnableVertexAttribArray(tintLoc);
+        pglVertexAttribPointer(tintLoc, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(TriangulationInstance), (void*)(size_t)offsetof(TriangulationInstance, tint));
+        pglVertexAttribDivisor(tintLoc, 1);
+    }
 
-        *result = PSLG_ATTACK_TEMP_EDGES_MALLOC_ERROR;
+    pglUseProgram(prog);
+    pglDrawArraysInstanced(GL_TRIANGLES, 0, tri->gpu.uploaded_count * 3, instance_count);
+    pglBindVertexArray(0);
+    *result = SUCCESS;
+}
+
+/**
+ * @brief Uploads an SoA triangulation into its cached GPU buffers.
+ * @param[out] result If any fail occured.
+ * @param prog The shader program (with "position" and "normal" attributes).
+ * @param tri  The triangulation to upload.
+ * @return nothing
+ * @remark The GPU still wants the interleaved 28-byte vertex, so this is
+ * where the three arrays get zipped back together — once per mutation,
+ * not per frame.
+ */
+void upload_soa_triangulation(CanimResult* result, GLuint prog, TriangulationSoA* tri)
+{
+    const size_t vertex_size = 28;
+    const size_t total_bytes = tri->triangle_count * 3 * vertex_size;
+
+    uint8_t* data = malloc(total_bytes);
+    if (!data)
+    {
+        *result = DRAW_TRIANGULATION_MALLOC_ERROR;
         return;
     }
 
-    int EI = 0;
-    for (int i = 0; i < pslg->edge_count; i++)
+    uint8_t* p = data;
+    for (int i = 0; i < tri->triangle_count; i++)
     {
-        // sacrifice e1, and e2
-        if (i == e1 || i == e2)
+        Vec3 n = tri->normals[i];
+        uint32_t col = tri->colors[i].rgba;
+        for (int v = 0; v < 3; v++)
         {
-            continue;
+            Vec3 pos = tri->positions[i * 3 + v];
+            *(float*)(p + 0)  = pos.x;
+            *(float*)(p + 4)  = pos.y;
+            *(float*)(p + 8)  = pos.z;
+            *(float*)(p + 12) = n.x;
+            *(float*)(p + 16) = n.y;
+            *(float*)(p + 20) = n.z;
+            *(uint32_t*)(p + 24) = col;
+            p += vertex_size;
         }
-        temp[EI][0] = pslg->edges[i][0];
-        temp[EI][1] = pslg->edges[i][1];
-
-        EI++;
     }
 
-    // so e3_exists
-    // handle it
-    if (!e3_exists)
+    if (!tri->gpu.vao)
     {
-        temp[EI][0] = v1;
-        temp[EI][1] = v2;
+        pglGenVertexArrays(1, &tri->gpu.vao);
     }
-    if (REALIGN(pslg->edge_count, ecount))
+    pglBindVertexArray(tri->gpu.vao);
+
+    if (!tri->gpu.vbo)
     {
-        int (*temp_ptr)[2] = realloc(pslg->edges, BIT_ALIGN(ecount) * sizeof(int[2]));
-        
-        if (temp_ptr == null)
-        {
-            printf("FAIL: %i\n", BIT_ALIGN(ecount));
+        pglGenBuffers(1, &tri->gpu.vbo);
+    }
+    pglBindBuffer(GL_ARRAY_BUFFER, tri->gpu.vbo);
+    pglBufferData(GL_ARRAY_BUFFER, total_bytes, data, GL_STATIC_DRAW);
+    free(data);
 
-            *result = PSLG_ATTACK_EDGE_REALLOCATION_ERROR;
-            free(temp);
-            return;
-        }
-        printf("WIN: %i\n", BIT_ALIGN(ecount));
+    GLint posLoc   = pglGetAttribLocation(prog, "position");
+    GLint normLoc  = pglGetAttribLocation(prog, "normal");
+    GLint colorLoc = pglGetAttribLocation(prog, "color");
 
-        pslg->edges = temp_ptr;
+    if (posLoc >= 0)
+    {
+        pglEnableVertexAttribArray(posLoc);
+        pglVertexAttribPointer(posLoc, 3, GL_FLOAT, GL_FALSE, 28, (void*)0);
     }
-    pslg->edge_count = ecount;
-    // time to populate the data
-    for (int i = 0; i < ecount; i++)
+    if (normLoc >= 0)
     {
-        pslg->edges[i][0] = temp[i][0];
-        pslg->edges[i][1] = temp[i][1];
+        pglEnableVertexAttribArray(normLoc);
+        pglVertexAttribPointer(normLoc, 3, GL_FLOAT, GL_FALSE, 28, (void*)12);
     }
-    free(temp); // this is temporary
+    if (colorLoc >= 0)
+    {
+        pglEnableVertexAttribArray(colorLoc);
+        pglVertexAttribPointer(colorLoc, 4, GL_UNSIGNED_BYTE, GL_TRUE, 28, (void*)24);
+    }
+
+    pglBindVertexArray(0);
+    tri->gpu.uploaded_count = tri->triangle_count;
+    tri->gpu.uploaded = true;
     *result = SUCCESS;
 }
 
 /**
- * @brief This attacks a single vertex
- * @param[out] result This is the status
- * @param pslgtri This is the PSLGTriangulation to attack
- * @return nothing
+ * @brief Draws an SoA triangulation, uploading it first only if it changed.
+ * @param[out] result If any fail occured.
+ * @param prog The shader program (with "position" and "normal" attributes).
+ * @param tri  The triangulation to draw.
  */
-
-void attack_single_vertex(CanimResult* result, PSLGTriangulation* pslgtri)
+void draw_soa_triangulation(CanimResult* result, GLuint prog, TriangulationSoA* tri)
 {
-    for(int i = 0; i < pslgtri->pslg->vertex_count; i++)
+    if (!tri->gpu.uploaded)
     {
-        attack_vertex(result, pslgtri, i);
-        if (*result == SUCCESS)
+        upload_soa_triangulation(result, prog, tri);
+        if (IS_AN_ERROR(*result))
         {
             return;
         }
-        if(*result == NOOP)
-        {
-            continue;
-        }
-        return;
     }
-    *result = NOOP;
+
+    pglBindVertexArray(tri->gpu.vao);
+    pglUseProgram(prog);
+    glDrawArrays(GL_TRIANGLES, 0, tri->gpu.uploaded_count * 3);
+    pglBindVertexArray(0);
+    *result = SUCCESS;
 }
 
 /**
- * @brief This attacks a all vertices
- * @param[out] result This is the status
- * @param pslgtri This is the PSLGTriangulation to attack
+ * @brief Hashes one render vertex (pool index plus face data)
+ * @param pool_idx The index into the shared vertex pool
+ * @param fd The face data of the triangle using the vertex
+ * @return The hash
+ */
+
+static uint32_t render_vertex_hash(int pool_idx, FaceData fd)
+{
+    uint32_t bits[3];
+    memcpy(bits, &fd.normal, sizeof(bits));
+    uint32_t h = (uint32_t)pool_idx * 2654435761u;
+    h ^= fd.color.rgba * 2246822519u;
+    h ^= bits[0] * 3266489917u;
+    h ^= bits[1] * 668265263u;
+    h ^= bits[2] * 374761393u;
+    return h;
+}
+
+/**
+ * @brief Uploads an indexed triangulation into its cached GPU buffers.
+ * @param[out] result The status
+ * @param prog The shader program (with "position" and "normal" attributes).
+ * @param itri The indexed triangulation to upload.
  * @return nothing
+ * @remark The shader wants a normal and a color per vertex, so pool
+ * vertices are expanded per distinct (vertex, face data) pair; within a
+ * face the pair is shared, which is what lets glDrawElements hit the GPU
+ * vertex cache instead of pushing every corner three times.
  */
 
-void attack_all_vertices(CanimResult* result, PSLGTriangulation* pslgtri)
+void upload_indexed_triangulation(CanimResult* result, GLuint prog, IndexedTriangulation* itri)
 {
-    for(;;)
+    const size_t vertex_size = 28;
+    int ncorners = itri->triangle_count * 3;
+
+    uint8_t* data = malloc(max(ncorners, 1) * vertex_size);
+    uint32_t* indices = malloc(max(ncorners, 1) * sizeof(uint32_t));
+    int* rv_pool = malloc(max(ncorners, 1) * sizeof(int));
+    FaceData* rv_fd = malloc(max(ncorners, 1) * sizeof(FaceData));
+    uint32_t table_size = 1;
+    for (;table_size < (uint32_t)(ncorners * 2 + 2);)
+    {
+        table_size <<= 1;
+    }
+    int* head = malloc(table_size * sizeof(int));
+    int* next = malloc(max(ncorners, 1) * sizeof(int));
+    if (!data || !indices || !rv_pool || !rv_fd || !head || !next)
+    {
+        free(data);
+        free(indices);
+        free(rv_pool);
+        free(rv_fd);
+        free(head);
+        free(next);
+        *result = DRAW_INDEXED_TRIANGULATION_MALLOC_ERROR;
+        return;
+    }
+    for (uint32_t i = 0; i < table_size; i++)
     {
-        attack_single_vertex(result, pslgtri);
-        if(*result == NOOP)
-        {
-            *result = SUCCESS;
-            return;
-        }
-        if (IS_AN_ERROR(*result))
+        head[i] = -1;
+    }
+    int nrender = 0;
+    for (int i = 0; i < itri->triangle_count; i++)
+    {
+        FaceData fd = itri->triangles[i].fd;
+        for (int v = 0; v < 3; v++)
         {
-            return; // the error propagates another level
+            int pool_idx = itri->triangles[i].vertices[v];
+            uint32_t slot = render_vertex_hash(pool_idx, fd) & (table_size - 1);
+            int found = -1;
+            for (int j = head[slot]; j >= 0; j = next[j])
+            {
+                if (rv_pool[j] == pool_idx && memcmp(&rv_fd[j], &fd, sizeof(FaceData)) == 0)
+                {
+                    found = j;
+                    break;
+                }
+            }
+            if (found < 0)
+            {
+                found = nrender;
+                rv_pool[found] = pool_idx;
+                rv_fd[found] = fd;
+                next[found] = head[slot];
+                head[slot] = found;
+                Vec3 p = itri->vertices[pool_idx];
+                uint8_t* dst = data + (size_t)found * vertex_size;
+                *(float*)(dst + 0)  = p.x;
+                *(float*)(dst + 4)  = p.y;
+                *(float*)(dst + 8)  = p.z;
+                *(float*)(dst + 12) = fd.normal.x;
+                *(float*)(dst + 16) = fd.normal.y;
+                *(float*)(dst + 20) = fd.normal.z;
+                *(uint32_t*)(dst + 24) = fd.color.rgba;
+                nrender++;
+            }
+            indices[i * 3 + v] = (uint32_t)found;
         }
     }
-}
+    free(rv_pool);
+    free(rv_fd);
+    free(head);
+    free(next);
 
-/**
- * @brief This generates a triangulation of a polygon
- * @param[out] result This is the status
- * @param vertices These are the vertices
- * @param vertex_count This is the amount of vertices
- * @param tri This is where the triangulation will be stored.
- * @return output nothing
- */
+    if (!itri->gpu.vao)
+    {
+        pglGenVertexArrays(1, &itri->gpu.vao);
+    }
+    pglBindVertexArray(itri->gpu.vao);
 
-void generate_triangulation(CanimResult* result, PolygonRaw pr, Triangulation* tri)
-{
-    PSLG* pslg = generate_pslg(result, pr);
-    if (IS_AN_ERROR(*result))
+    if (!itri->gpu.vbo)
     {
-        return;
+        pglGenBuffers(1, &itri->gpu.vbo);
     }
-    split_entirely(result, pslg);
-    if (IS_AN_ERROR(*result))
+    pglBindBuffer(GL_ARRAY_BUFFER, itri->gpu.vbo);
+    pglBufferData(GL_ARRAY_BUFFER, (size_t)nrender * vertex_size, data, GL_STATIC_DRAW);
+    free(data);
+
+    if (!itri->gpu.ibo)
     {
-        free_pslg(pslg);
-        return;
+        pglGenBuffers(1, &itri->gpu.ibo);
     }
-    
-    PSLGTriangulation* pslgtri = create_pslg_triangulation(result, pslg);
-    if (IS_AN_ERROR(*result))
+    pglBindBuffer(GL_ELEMENT_ARRAY_BUFFER, itri->gpu.ibo);
+    pglBufferData(GL_ELEMENT_ARRAY_BUFFER, (size_t)ncorners * sizeof(uint32_t), indices, GL_STATIC_DRAW);
+    free(indices);
+
+    GLint posLoc   = pglGetAttribLocation(prog, "position");
+    GLint normLoc  = pglGetAttribLocation(prog, "normal");
+    GLint colorLoc = pglGetAttribLocation(prog, "color");
+
+    if (posLoc >= 0)
     {
-        free_triangulation(pslgtri->triangulation);
-        free_pslg(pslg);
-        free(pslgtri);
-        return;
+        pglEnableVertexAttribArray(posLoc);
+        pglVertexAttribPointer(posLoc, 3, GL_FLOAT, GL_FALSE, 28, (void*)0);
     }
-    attack_all_vertices(result, pslgtri);
-    if (IS_AN_ERROR(*result))
+    if (normLoc >= 0)
     {
-        free_triangulation(pslgtri->triangulation);
-        free_pslg(pslg);
-        free(pslgtri);
-        return;
+        pglEnableVertexAttribArray(normLoc);
+        pglVertexAttribPointer(normLoc, 3, GL_FLOAT, GL_FALSE, 28, (void*)12);
+    }
+    if (colorLoc >= 0)
+    {
+        pglEnableVertexAttribArray(colorLoc);
+        pglVertexAttribPointer(colorLoc, 4, GL_UNSIGNED_BYTE, GL_TRUE, 28, (void*)24);
     }
 
-    for(int i = 0; i < pslgtri->triangulation->triangle_count; i++)
+    pglBindVertexArray(0);
+    itri->gpu.index_count = ncorners;
+    itri->gpu.uploaded = true;
+    *result = SUCCESS;
+}
+
+/**
+ * @brief Draws an indexed triangulation, uploading it first if it changed.
+ * @param[out] result The status
+ * @param prog The shader program (with "position" and "normal" attributes).
+ * @param itri The indexed triangulation to draw.
+ */
+void draw_indexed_triangulation(CanimResult* result, GLuint prog, IndexedTriangulation* itri)
+{
+    if (!itri->gpu.uploaded)
     {
-        add_triangle(result, tri, 
-            pslgtri->triangulation->triangles[i]
-        );
+        upload_indexed_triangulation(result, prog, itri);
         if (IS_AN_ERROR(*result))
         {
-            free_triangulation(pslgtri->triangulation);
-            free_pslg(pslg);
-            free(pslgtri);
             return;
         }
     }
-    tri->triangle_count = pslgtri->triangulation->triangle_count;
 
-    free_pslg(pslg);
-    free_triangulation(pslgtri->triangulation);
-    free(pslgtri);
+    pglBindVertexArray(itri->gpu.vao);
+    pglUseProgram(prog);
+    glDrawElements(GL_TRIANGLES, itri->gpu.index_count, GL_UNSIGNED_INT, (void*)0);
+    pglBindVertexArray(0);
     *result = SUCCESS;
 }
 
 /**
- * @brief Triangulates the polyhedron
+ * @brief Draws the right level of a level-of-detail chain for a distance
  * @param[out] result The status
- * @param poly The polyhedron to be triangulated
- * @param out Where the triangulation is stored
- * @return nothing
+ * @param prog The shader program (with "position" and "normal" attributes).
+ * @param lod The chain
+ * @param distance How far the camera eye is from the mesh in view space
+ * @remark Levels upload lazily like everything else, so a level that
+ * never comes on screen never costs GPU memory either.
  */
+void draw_lod_chain(CanimResult* result, GLuint prog, LODChain* lod, float distance)
+{
+    draw_indexed_triangulation(result, prog, lod_chain_select(lod, distance));
+}
 
-void triangulate_polyhedron(CanimResult* result, Polyhedron* poly, Triangulation* out)
+
+
+/**
+ * @brief Runs the animations of a VideoData frame by frame
+ * @remark Admission works off a start-time-sorted index, so each frame
+ * only touches the animations that actually cover it plus whatever starts
+ * on it; the thousands of not-yet-started ones never get scanned.
+ */
+
+typedef struct
 {
-    Triangulation** tris = malloc(poly->face_count * sizeof(Triangulation*));
-    if (!tris)
+    /**
+     *  @brief The video data being played
+     *  */
+    VideoData* vd;
+    /**
+     *  @brief Animation indices sorted by start time
+     *  */
+    int* by_start;
+    /**
+     *  @brief The currently live animation indices, in admission order
+     *  */
+    int* active;
+    /**
+     *  @brief How many animations are live right now
+     *  */
+    int active_count;
+    /**
+     *  @brief Cursor into by_start: the first animation not yet admitted
+     *  */
+    int next_start;
+}
+AnimationScheduler;
+
+/**
+ * @brief The sort key for the admission index
+ */
+
+typedef struct
+{
+    /**
+     *  @brief The start time
+     *  */
+    int start_t;
+    /**
+     *  @brief The animation index
+     *  */
+    int idx;
+}
+AnimationStartKey;
+
+/**
+ * @brief qsort comparator for AnimationStartKey, earliest start first
+ * @param a The first key
+ * @param b The second key
+ * @return the usual negative/zero/positive
+ */
+
+static int animation_start_cmp(const void* a, const void* b)
+{
+    const AnimationStartKey* ka = a;
+    const AnimationStartKey* kb = b;
+    if (ka->start_t != kb->start_t)
     {
-        *result = TRIANGULATE_POLYHEDRON_BATCH_TRIANGULATIONS_MALLOC_ERROR;
-        return;
+        return ka->start_t < kb->start_t ? -1 : 1;
     }
+    // same frame: keep the declaration order stable
+    return ka->idx - kb->idx;
+}
 
-    for (int i = 0; i < poly->face_count; i++)
+/**
+ * @brief Builds a scheduler over the animations of a VideoData
+ * @param[out] result The status
+ * @param vd The video data
+ * @return The scheduler, ready for frame zero
+ */
+
+AnimationScheduler* create_animation_scheduler(CanimResult* result, VideoData* vd)
+{
+    AnimationScheduler* sched = malloc(sizeof(AnimationScheduler));
+    if (!sched)
     {
-        tris[i] = NULL;
+        *result = ANIMATION_SCHEDULER_MALLOC_ERROR;
+        return null;
+    }
+    sched->vd = vd;
+    sched->active_count = 0;
+    sched->next_start = 0;
+    sched->by_start = malloc(max(vd->animation_count, 1) * sizeof(int));
+    sched->active = malloc(max(vd->animation_count, 1) * sizeof(int));
+    AnimationStartKey* keys = malloc(max(vd->animation_count, 1) * sizeof(AnimationStartKey));
+    if (!sched->by_start || !sched->active || !keys)
+    {
+        free(keys);
+        free(sched->by_start);
+        free(sched->active);
+        free(sched);
+        *result = ANIMATION_SCHEDULER_MALLOC_ERROR;
+        return null;
+    }
+    for (int i = 0; i < vd->animation_count; i++)
+    {
+        keys[i].start_t = vd->Animation[i].start_t;
+        keys[i].idx = i;
     }
+    qsort(keys, vd->animation_count, sizeof(AnimationStartKey), animation_start_cmp);
+    for (int i = 0; i < vd->animation_count; i++)
+    {
+        sched->by_start[i] = keys[i].idx;
+    }
+    free(keys);
+    *result = SUCCESS;
+    return sched;
+}
 
-    for (int i = 0; i < poly->face_count; i++)
+/**
+ * @brief Runs one frame of the schedule
+ * @param[out] result The status
+ * @param sched The scheduler
+ * @param frame The frame to run
+ * @return nothing
+ * @remark Frames must come in order. Animations whose window opens on
+ * this frame get constructed, ones whose window closed get freed right
+ * here (so a finished animation gives its memory back mid-render), and
+ * everything live runs preproc, then render, then postproc.
+ */
+
+void animation_scheduler_step(CanimResult* result, AnimationScheduler* sched, int frame)
+{
+    VideoData* vd = sched->vd;
+    // admit everything whose window has opened by now
+    for (;sched->next_start < vd->animation_count;)
     {
-        Triangulation* t = empty_triangulation(result);
-        if (IS_AN_ERROR(*result))
+        int idx = sched->by_start[sched->next_start];
+        Animation* anim = &vd->Animation[idx];
+        if (anim->start_t > frame)
+        {
+            break;
+        }
+        sched->next_start++;
+        if (anim->end_t < frame)
+        {
+            // already over before we got here, never goes live
+            continue;
+        }
+        if (anim->construct)
         {
-            for (int j = 0; j < i; j++)
+            anim->construct(result, anim);
+            if (IS_AN_ERROR(*result))
             {
-                if (tris[j]) 
-                {
-                    free_triangulation(tris[j]);
-                }
+                return;
             }
-            free(tris);
-            return;
         }
-        PolygonIndexed* face = &poly->poly[i];
-        Vec3* verts = malloc(BIT_ALIGN(face->vertex_count) * sizeof(Vec3));
-        if (!verts)
+        sched->active[sched->active_count] = idx;
+        sched->active_count++;
+    }
+    // retire everything whose window has closed
+    int kept = 0;
+    for (int i = 0; i < sched->active_count; i++)
+    {
+        Animation* anim = &vd->Animation[sched->active[i]];
+        if (anim->end_t < frame)
         {
-            *result = TRIANGULATE_POLYHEDRON_VERTEX_MALLOC_ERROR;
-            free_triangulation(t);
-            for (int j = 0; j < i; j++)
+            if (anim->free)
             {
-                if (tris[j]) 
+                anim->free(result, anim);
+                if (IS_AN_ERROR(*result))
                 {
-                    free_triangulation(tris[j]);
+                    return;
                 }
             }
-            free(tris);
-            return;
-        }
-
-        for (int v = 0; v < face->vertex_count; v++)
-        {
-            verts[v] = poly->vertices[face->vertices[v]];
+            continue;
         }
-
-        PolygonRaw pr = 
-        {
-            .vertex_count = face->vertex_count,
-            .vertices = verts,
-            .fd = face->fd
-        };
-        
-        generate_triangulation(result, pr, t);
-        free(verts);
-        if (IS_AN_ERROR(*result))
+        sched->active[kept] = sched->active[i];
+        kept++;
+    }
+    sched->active_count = kept;
+    // the three per-frame phases, each over every live animation
+    for (int i = 0; i < sched->active_count; i++)
+    {
+        Animation* anim = &vd->Animation[sched->active[i]];
+        if (anim->preproc)
         {
-            free_triangulation(t);
-            for (int j = 0; j < i; j++)
+            anim->preproc(result, anim, frame);
+            if (IS_AN_ERROR(*result))
             {
-                if (tris[j]) 
-                {
-                    free_triangulation(tris[j]);
-                }
+                return;
             }
-            free(tris);
-            return;
         }
-
-        tris[i] = t;
     }
-
-    merge_triangulations(result, tris, poly->face_count, out);
-    for (int i = 0; i < poly->face_count; i++)
+    for (int i = 0; i < sched->active_count; i++)
     {
-        if (tris[i]) 
+        Animation* anim = &vd->Animation[sched->active[i]];
+        if (anim->render)
         {
-            free_triangulation(tris[i]);
+            anim->render(result, anim, frame);
+            if (IS_AN_ERROR(*result))
+            {
+                return;
+            }
         }
     }
-    free(tris);
-
-    if (IS_AN_ERROR(*result))
+    for (int i = 0; i < sched->active_count; i++)
     {
-        return;
+        Animation* anim = &vd->Animation[sched->active[i]];
+        if (anim->postproc)
+        {
+            anim->postproc(result, anim, frame);
+            if (IS_AN_ERROR(*result))
+            {
+                return;
+            }
+        }
     }
-
     *result = SUCCESS;
 }
 
-
 /**
- * @brief This takes a polyhedron and frees it
- * @param poly This is the polyhedron to be freed
+ * @brief Frees the scheduler, releasing any still-live animations
+ * @param[out] result The status
+ * @param sched The scheduler
  * @return nothing
  */
 
-
-void free_polyhedron(Polyhedron* poly)
+void free_animation_scheduler(CanimResult* result, AnimationScheduler* sched)
 {
-    if (!poly) 
+    *result = SUCCESS;
+    if (!sched)
     {
         return;
     }
-    
-
-    if (poly->poly)
+    for (int i = 0; i < sched->active_count; i++)
     {
-        for (int i = 0; i < poly->face_count; i++)
+        Animation* anim = &sched->vd->Animation[sched->active[i]];
+        if (anim->free)
         {
-            PolygonIndexed* face = &poly->poly[i];
-            if (face->vertices)
-            {
-                free(face->vertices);
-            }
+            // keep going even if one free fails, report the last error
+            anim->free(result, anim);
         }
-        free(poly->poly);
-    }
-
-    if (poly->vertices)
-    {
-        free(poly->vertices);
     }
-
-    free(poly);
+    free(sched->by_start);
+    free(sched->active);
+    free(sched);
 }
 
+// the bench driver includes this file and brings its own main
+#ifndef CANIM_BENCH_DRIVER
+
+/**
+ * @brief One render job: which model goes into which video
+ */
 
+typedef struct
+{
+    /**
+     * @brief The OFF input
+     */
+    char* input;
+    /**
+     * @brief The mp4 output
+     */
+    char* output;
+}
+RenderJob;
 
 /**
- * @brief This allocates memory for a polyhedron
- * @param[out] result This is the status of this function
- * @param nv The vertex count
- * @param nf The face count
- * @return A pointer to your brand new polyhedron
+ * @brief Copies a string for the job list
+ * @param[out] result The status
+ * @param s The string
+ * @return The copy, or null
  */
 
-Polyhedron* create_polyhedron(CanimResult* result, int nv, int nf) 
+static char* copy_job_string(CanimResult* result, const char* s)
 {
-    Polyhedron* poly = malloc(sizeof(Polyhedron));
-    if (!poly)
-    {
-        *result = POLYHEDRON_MALLOC_ERROR;
-        return NULL;
-    }
-    poly->face_count=nf;
-    poly->vertex_count=nv;
-    poly->vertices = malloc(sizeof(Vec3) * nv);
-    if(!poly->vertices)
+    char* copy = malloc(strlen(s) + 1);
+    if (!copy)
     {
-        free(poly);
-        *result = POLYHEDRON_VERTEX_MALLOC_ERROR;
-        return NULL;
+        *result = BATCH_MALLOC_ERROR;
+        return null;
     }
-    poly->poly = malloc(sizeof(PolygonIndexed) * nf);
-    if(!poly->poly)
+    strcpy(copy, s);
+    *result = SUCCESS;
+    return copy;
+}
+
+/**
+ * @brief Frees a job list
+ * @param jobs The jobs
+ * @param job_count How many there are
+ * @return nothing
+ */
+
+static void free_render_jobs(RenderJob* jobs, int job_count)
+{
+    for (int i = 0; i < job_count; i++)
     {
-        free(poly->vertices);
-        free(poly);
-        *result = POLYHEDRON_FACE_MALLOC_ERROR;
-        return NULL;
+        free(jobs[i].input);
+        free(jobs[i].output);
     }
-    return poly;
+    free(jobs);
 }
 
-
 /**
- * @brief Do not touch
- * @param[out] result You know
- * @param fin The file
- * @param buf The output
- * @return nothing
+ * @brief Reads a batch manifest: one "input.off output.mp4" pair per line
+ * @param[out] result The status
+ * @param path The manifest file
+ * @param[out] out_count How many jobs came out
+ * @return The jobs (caller frees via free_render_jobs), or null
+ * @remark Blank lines are fine; a line with only one token is not.
  */
 
-void read_clean_line(CanimResult* result, FILE* fin, char* buf)
+static RenderJob* read_render_manifest(CanimResult* result, const char* path, int* out_count)
 {
-    for (;fgets(buf, BUFFER_SIZE, fin);) 
+    FILE* f = fopen(path, "r");
+    if (!f)
+    {
+        *result = BATCH_MANIFEST_ERROR;
+        return null;
+    }
+    RenderJob* jobs = null;
+    int count = 0;
+    int capacity = 0;
+    char line[BUFFER_SIZE];
+    for (;fgets(line, sizeof(line), f);)
     {
-        buf[strcspn(buf, "\r\n")] = 0;             
-        char* h = strchr(buf, '#'); 
-        if (h) 
+        char in[BUFFER_SIZE];
+        char out[BUFFER_SIZE];
+        int got = sscanf(line, "%4095s %4095s", in, out);
+        if (got <= 0)
         {
-            *h = 0;
+            continue;
         }
-        char* p = buf + strspn(buf, " \t"); 
-        size_t n = strlen(p);
-        for (;n && (p[n-1]==' ' || p[n-1]=='\t');)
+        if (got != 2)
         {
-            p[--n] = 0;
+            free_render_jobs(jobs, count);
+            fclose(f);
+            *result = BATCH_MANIFEST_ERROR;
+            return null;
         }
-        if (*p == 0) 
+        if (count == capacity)
         {
-            continue;            
-        }         
-        if (p != buf)
+            capacity = BIT_ALIGN(count + 1);
+            RenderJob* grown = realloc(jobs, capacity * sizeof(RenderJob));
+            if (!grown)
+            {
+                free_render_jobs(jobs, count);
+                fclose(f);
+                *result = BATCH_MALLOC_ERROR;
+                return null;
+            }
+            jobs = grown;
+        }
+        jobs[count].input = copy_job_string(result, in);
+        jobs[count].output = jobs[count].input ? copy_job_string(result, out) : null;
+        if (!jobs[count].input || !jobs[count].output)
         {
-            memmove(buf, p, n+1);  
+            free(jobs[count].input);
+            free_render_jobs(jobs, count);
+            fclose(f);
+            return null;
         }
-        *result = SUCCESS;
-        return;
+        count++;
     }
-    *result = FILE_NO_CLEAN_LINE_OFF_ERROR;
+    fclose(f);
+    *out_count = count;
+    *result = SUCCESS;
+    return jobs;
 }
 
 /**
- * @brief Reading off header
- * @param[out] result result
- * @param fin the file
- * @param nv The number of vertices to be written to
- * @param nf The number of faces
- * @return nothing
+ * @brief Loads a model (through the triangulation cache) and indexes it
+ * @param[out] result The status
+ * @param off_path The OFF file
+ * @param export_stl Whether to also drop a <off_path>.stl next to it
+ * @return The indexed triangulation, or null
  */
 
-void read_off_header(CanimResult* result, FILE* fin, int* nv, int* nf)
+static IndexedTriangulation* load_indexed_model(CanimResult* result, const char* off_path, bool export_stl)
 {
-    char line[BUFFER_SIZE];
-    read_clean_line(result, fin, line);
+    uint64_t off_hash = hash_file_contents(result, off_path);
     if (IS_AN_ERROR(*result))
     {
-        return;
+        return null;
     }
-    if (strcmp(line , "OFF") != 0)
+    char cache_path[BUFFER_SIZE];
+    snprintf(cache_path, sizeof(cache_path), "%s.tricache", off_path);
+    Triangulation* tri = load_triangulation_cache(result, cache_path, off_hash);
+    if (IS_AN_ERROR(*result))
     {
-        *result = OFF_HEADER_OFF_ERROR;
-        return;
+        return null;
     }
-    read_clean_line(result, fin, line);
-    if (IS_AN_ERROR(*result))
+    if (!tri)
     {
-        return;
+        // cold start: parse, triangulate, and leave a cache behind
+        FILE* fin = fopen(off_path, "r");
+        Polyhedron* poly = read_off_into_polyhedron(result, fin);
+        if (fin)
+        {
+            fclose(fin);
+        }
+        if (IS_AN_ERROR(*result))
+        {
+            return null;
+        }
+        tri = empty_triangulation(result);
+        if (IS_AN_ERROR(*result))
+        {
+            return null;
+        }
+        triangulate_polyhedron(result, poly, tri);
+        if (IS_AN_ERROR(*result))
+        {
+            return null;
+        }
+        save_triangulation_cache(result, cache_path, off_hash, tri);
+        if (IS_AN_ERROR(*result))
+        {
+            // a failed cache write is a shame, not a reason to stop
+            print_error(*result);
+        }
     }
-    char* t = strtok(line, " \t");
-    if (!t) 
+    IndexedTriangulation* itri = index_triangulation(result, tri);
+    if (IS_AN_ERROR(*result))
     {
-        *result = OFF_HEADER_DATA_ERROR;
-        return;
+        return null;
     }
-    *nv = atoi(t);
-    t = strtok(null, " \t");
-    if (!t) 
+    // the raw copy is redundant now, everything downstream is indexed
+    free_triangulation(tri);
+    if (export_stl)
     {
-        *result = OFF_HEADER_DATA_ERROR;
-        return;
+        char stl_path[BUFFER_SIZE];
+        snprintf(stl_path, sizeof(stl_path), "%s.stl", off_path);
+        FILE* fout = fopen(stl_path, "wb");
+        if (!fout)
+        {
+            free_indexed_triangulation(itri);
+            *result = STL_HEADER_WRITE_ERROR;
+            return null;
+        }
+        write_indexed_to_stl(result, itri, fout);
+        fclose(fout);
+        if (IS_AN_ERROR(*result))
+        {
+            free_indexed_triangulation(itri);
+            return null;
+        }
     }
-    *nf = atoi(t);
     *result = SUCCESS;
+    return itri;
 }
 
 /**
- * @brief Reading vertex
- * @param[out] result result
- * @param fin the file
- * @param poly The polyhedron to write to
- * @param vertex_idx The index to write to
- * @return nothing
+ * @brief Everything the render jobs of one process share: the shader, the
+ * offscreen target, the readback pipeline, and the camera. Built once,
+ * reused for every job, so per-video startup is just a model load and an
+ * ffmpeg spawn.
  */
 
-void read_vertex(CanimResult* result, FILE* fin, Polyhedron* poly, int vertex_idx)
+typedef struct
 {
-    char line[BUFFER_SIZE];
-    read_clean_line(result, fin, line);
-    if (IS_AN_ERROR(*result))
-    {
-        return;
-    }
-    char* t = strtok(line, " \t");
-    if (!t) 
-    {
-        *result = OFF_VERTEX_ERROR;
-        return;
-    }
-    poly->vertices[vertex_idx].x = atof(t);
-    t = strtok(null, " \t");
-    if (!t) 
-    {
-        *result = OFF_VERTEX_ERROR;
-        return;
-    }
-    poly->vertices[vertex_idx].y = atof(t);
-    t = strtok(null, " \t");
-    if (!t) 
-    {
-        *result = OFF_VERTEX_ERROR;
-        return;
-    }
-    poly->vertices[vertex_idx].z = atof(t);
-    *result = SUCCESS;
+    /**
+     * @brief The shader program
+     */
+    GLuint prog;
+    /**
+     * @brief The msaa render target
+     */
+    OffscreenTarget target;
+    /**
+     * @brief The tiled readback pipeline
+     */
+    FramebufferReader reader;
+    /**
+     * @brief The camera move every video gets
+     */
+    CameraPath* camera;
+    /**
+     * @brief How long one orbit (and so one video) lasts
+     */
+    float orbit_seconds;
+    /**
+     * @brief The projection matrix
+     */
+    float proj[16];
+    /**
+     * @brief The cached mvp uniform location
+     */
+    GLint mvp_loc;
+    /**
+     * @brief The cached modelview uniform location
+     */
+    GLint modelview_loc;
+    /**
+     * @brief Render width
+     */
+    int width;
+    /**
+     * @brief Render height
+     */
+    int height;
+    /**
+     * @brief Frames per second
+     */
+    int fps;
 }
+RenderContext;
 
 /**
- * @brief Reading faces
- * @param[out] result result
- * @param fin File
- * @param poly The polyhedron to write to
- * @param face_idx The index
+ * @brief Builds the shared render state (GL must be loaded already)
+ * @param[out] result The status
+ * @param rc The context
+ * @param width Render width
+ * @param height Render height
+ * @param fps Frames per second
  * @return nothing
  */
 
-void read_face(CanimResult* result, FILE* fin, Polyhedron* poly, int face_idx)
+static void render_context_init(CanimResult* result, RenderContext* rc, int width, int height, int fps)
 {
-    char line[BUFFER_SIZE];
-    read_clean_line(result, fin, line);
+    rc->width = width;
+    rc->height = height;
+    rc->fps = fps;
+    rc->prog = create_shader_program(result, triangulation_vs, triangulation_fs);
     if (IS_AN_ERROR(*result))
     {
         return;
     }
-    char* t = strtok(line, " \t");
-    if (!t) 
+    offscreen_target_init(result, &rc->target, width, height, 4);
+    if (IS_AN_ERROR(*result))
     {
-        *result = OFF_FACE_ERROR;
         return;
     }
-    poly->poly[face_idx].vertex_count = atoi(t);
-    /// TODO: Fix this utter piece of trash
-    poly->poly[face_idx].vertices = malloc(sizeof(int) * poly->poly[face_idx].vertex_count);
-    for (int i = 0; i < poly->poly[face_idx].vertex_count; i++)
-    {
-        t = strtok(null, " \t");
-        if (!t) 
-        {
-            *result = OFF_FACE_ERROR;
-            return;
-        }
-        poly->poly[face_idx].vertices[i] = atoi(t);
-    }
-    poly->poly[face_idx].fd.normal = normal_vec3
-    (
-        poly->vertices[poly->poly[face_idx].vertices[0]],
-        poly->vertices[poly->poly[face_idx].vertices[1]],
-        poly->vertices[poly->poly[face_idx].vertices[2]]
-    );
-    poly->poly[face_idx].fd.color.rgba = 0xff7f7f00 + (uint32_t)((float)face_idx*(float)0xff / ((float)poly->face_count));
-    *result = SUCCESS;
-}
-
-/**
- * @brief Read OFF File and parse it into a polyhedron
- * @param[out] result The error code
- * @param fin
- * @return The polyhedron
- */
+    glViewport(0, 0, width, height);
+    glEnable(GL_MULTISAMPLE);
+    glEnable(GL_DEPTH_TEST);
 
-Polyhedron* read_off_into_polyhedron(CanimResult* result, FILE* fin)
-{
-    int nv = 0;
-    int nf = 0;
-    read_off_header(result, fin, &nv, &nf);
-    if (IS_AN_ERROR(*result))
+    // the old glRotatef spin as a camera move: orbit the object around
+    // the same (1, 1, 0) axis at radius 3, one revolution per six seconds
+    rc->orbit_seconds = 6.0f;
+    CameraKeyframe orbit[9];
+    Vec3 orbit_axis = { 1, 1, 0 };
+    for (int i = 0; i < 9; i++)
     {
-        return null;
+        float a = (float)i * CANIM_PI / 4.0f;
+        orbit[i].t = (float)i * rc->orbit_seconds / 8.0f;
+        orbit[i].orientation = quat_from_axis_angle(orbit_axis, a);
+        orbit[i].position = quat_rotate_vec3(orbit[i].orientation, (Vec3){ 0, 0, 3 });
     }
-    Polyhedron* poly = create_polyhedron(result, nv, nf);
+    rc->camera = create_camera_path(result, orbit, 9);
     if (IS_AN_ERROR(*result))
     {
-        return null;
-    }
-    for (int i = 0; i < nv; i++) 
-    {
-        read_vertex(result, fin, poly, i);
-        if (IS_AN_ERROR(*result))
-        {
-            free_polyhedron(poly);
-            return null;
-        }
+        return;
     }
-    for (int i = 0; i < nf; i++) 
+    float aspect = (float)width / (float)height;
+    mat4_frustum(rc->proj, -1 * aspect, 1 * aspect, -1, 1, 1, 10);
+    rc->mvp_loc = pglGetUniformLocation(rc->prog, "mvp");
+    rc->modelview_loc = pglGetUniformLocation(rc->prog, "modelview");
+    framebuffer_reader_init(result, &rc->reader, width, height);
+    if (IS_AN_ERROR(*result))
     {
-        read_face(result, fin, poly, i);
-        if (IS_AN_ERROR(*result))
-        {
-            free_polyhedron(poly);
-            return null;
-        }
+        free_camera_path(rc->camera);
+        return;
     }
-    return poly;
+    *result = SUCCESS;
 }
 
 /**
- * @brief Convert a uint32 to little-endian format
- * @param v The number to convert
- * @param b The new version
+ * @brief Tears the shared render state down
+ * @param rc The context
  * @return nothing
  */
 
-void le32_bytes(uint32_t v, unsigned char b[4]) 
+static void render_context_destroy(RenderContext* rc)
 {
-    b[0] = (unsigned char)((v >> 0) & 0xFFu);
-    b[1] = (unsigned char)((v >> 8) & 0xFFu);
-    b[2] = (unsigned char)((v >> 16) & 0xFFu);
-    b[3] = (unsigned char)((v >> 24) & 0xFFu);
+    framebuffer_reader_destroy(&rc->reader);
+    offscreen_target_destroy(&rc->target);
+    free_camera_path(rc->camera);
+    pglDeleteProgram(rc->prog);
 }
 
 /**
- * @brief Convert a float to little-endian format
- * @param v The number to convert
- * @param b The new version
+ * @brief Renders one orbit of one model into one mp4
+ * @param[out] result The status
+ * @param rc The shared render state
+ * @param itri The model
+ * @param out_mp4 Where the video goes
  * @return nothing
  */
 
-void lef32_bytes(float v, unsigned char b[4]) 
+static void render_model_video(CanimResult* result, RenderContext* rc, IndexedTriangulation* itri, const char* out_mp4)
 {
-    le32_bytes(*(uint32_t*)&v, b);
-}
-
-/**
- * @brief Writes a triangulation into an stl
- * @param[out] result
- * @param tri The triangulation
- * @param file The file
- * @return nothing
- */
-
-void write_to_stl(CanimResult* result, Triangulation* tri, FILE* fin)
-{   
-    unsigned char header[80];
-    memset(header, 0, sizeof(header));
-    if(fwrite(header, 1, 80, fin) != 80)
-    {
-        *result = STL_HEADER_WRITE_ERROR;
-        return;
-    }
-    unsigned char h[4];
-    le32_bytes((uint32_t)tri->triangle_count, h);
-    if(fwrite(h, 1, 4, fin) != 4)
+    FFmpegWriter* writer = open_ffmpeg_writer(result, rc->width, rc->height, rc->fps, out_mp4);
+    if (!writer)
     {
-        *result = STL_HEADER_WRITE_ERROR;
         return;
     }
-    for (int i = 0; i < tri->triangle_count; i++)
+    int total_frames = (int)(rc->orbit_seconds * rc->fps);
+    const unsigned char* rgb = null;
+    SDL_Event e;
+    bool aborted = false;
+    for (int frame = 0; frame < total_frames && !aborted; frame++)
     {
-        Vec3 a = tri->triangles[i].vertices[0];
-        Vec3 b = tri->triangles[i].vertices[1];
-        Vec3 c = tri->triangles[i].vertices[2];
-        Vec3 n = tri->triangles[i].fd.normal;
-        lef32_bytes(n.x, h);
-        if(fwrite(h, 1, 4, fin) != 4)
-        {
-            *result = STL_VECTOR_WRITE_ERROR;
-            return;
-        }
-        lef32_bytes(n.y, h);
-        if(fwrite(h, 1, 4, fin) != 4)
-        {
-            *result = STL_VECTOR_WRITE_ERROR;
-            return;
-        }
-        lef32_bytes(n.z, h);
-        if(fwrite(h, 1, 4, fin) != 4)
-        {
-            *result = STL_VECTOR_WRITE_ERROR;
-            return;
-        }
-        lef32_bytes(a.x, h);
-        if(fwrite(h, 1, 4, fin) != 4)
-        {
-            *result = STL_VECTOR_WRITE_ERROR;
-            return;
-        }
-        lef32_bytes(a.y, h);
-        if(fwrite(h, 1, 4, fin) != 4)
-        {
-            *result = STL_VECTOR_WRITE_ERROR;
-            return;
-        }
-        lef32_bytes(a.z, h);
-        if(fwrite(h, 1, 4, fin) != 4)
-        {
-            *result = STL_VECTOR_WRITE_ERROR;
-            return;
-        }
-        lef32_bytes(b.x, h);
-        if(fwrite(h, 1, 4, fin) != 4)
-        {
-            *result = STL_VECTOR_WRITE_ERROR;
-            return;
-        }
-        lef32_bytes(b.y, h);
-        if(fwrite(h, 1, 4, fin) != 4)
-        {
-            *result = STL_VECTOR_WRITE_ERROR;
-            return;
-        }
-        lef32_bytes(b.z, h);
-        if(fwrite(h, 1, 4, fin) != 4)
-        {
-            *result = STL_VECTOR_WRITE_ERROR;
-            return;
-        }
-        lef32_bytes(c.x, h);
-        if(fwrite(h, 1, 4, fin) != 4)
+        for (;SDL_PollEvent(&e);)
         {
-            *result = STL_VECTOR_WRITE_ERROR;
-            return;
+            if (e.type == SDL_QUIT)
+            {
+                aborted = true;
+            }
         }
-        lef32_bytes(c.y, h);
-        if(fwrite(h, 1, 4, fin) != 4)
+        glClearColor(0.0f,0.0f,0.0f,1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        // one matrix upload per frame instead of the fixed function stack
+        float t = (float)frame / (float)rc->fps;
+        Vec3 eye;
+        Quaternion look;
+        camera_path_eval(rc->camera, t, &eye, &look);
+        float view[16];
+        float mvp[16];
+        camera_view_matrix(view, eye, look);
+        mat4_mul(mvp, rc->proj, view);
+        pglUseProgram(rc->prog);
+        pglUniformMatrix4fv(rc->mvp_loc, 1, GL_FALSE, mvp);
+        pglUniformMatrix4fv(rc->modelview_loc, 1, GL_FALSE, view);
+        CANIM_PROF_BEGIN(CANIM_PROF_DRAW);
+        draw_indexed_triangulation(result, rc->prog, itri);
+        CANIM_PROF_END(CANIM_PROF_DRAW);
+        pglUseProgram(0);
+        if (IS_AN_ERROR(*result))
         {
-            *result = STL_VECTOR_WRITE_ERROR;
-            return;
+            break;
         }
-        lef32_bytes(c.z, h);
-        if(fwrite(h, 1, 4, fin) != 4)
+
+        // no swap, no vsync: resolve the msaa frame and read it back in
+        // stripes while the next one renders and the encoder chews on the
+        // previous one
+        offscreen_target_resolve(&rc->target);
+        glFlush();
+        CanimResult frame_result;
+        rgb = framebuffer_reader_grab(&frame_result, &rc->reader);
+        pglBindFramebuffer(GL_FRAMEBUFFER, rc->target.msaa_fbo);
+        if (frame_result == SUCCESS && rgb)
         {
-            *result = STL_VECTOR_WRITE_ERROR;
-            return;
+            ffmpeg_writer_submit(&frame_result, writer, rgb);
         }
-        unsigned char attr[2] = {0, 0};
-        if(fwrite(attr, 1, 2, fin) != 2)
+    }
+    {
+        // one frame is still in flight on the GPU, fetch it
+        CanimResult frame_result;
+        rgb = framebuffer_reader_drain(&frame_result, &rc->reader);
+        if (frame_result == SUCCESS && rgb)
         {
-            *result = STL_VECTOR_WRITE_ERROR;
-            return;
+            ffmpeg_writer_submit(&frame_result, writer, rgb);
         }
     }
-    *result = SUCCESS;
+    CanimResult close_result;
+    close_ffmpeg_writer(&close_result, writer);
+    if (!IS_AN_ERROR(*result))
+    {
+        *result = close_result;
+    }
 }
 
 /**
- * @brief Uploads and draws a triangulation using shaders.
- * @param[out] result If any fail occured.
- * @param prog The shader program (with "position" and "normal" attributes).
- * @param tri  The triangulation to draw.
+ * @brief Renders this worker's slice of the job list
+ * @param jobs The jobs
+ * @param job_count How many there are
+ * @param worker Which slice is ours
+ * @param workers How many slices there are
+ * @param width Render width
+ * @param height Render height
+ * @param fps Frames per second
+ * @param export_stl Whether each model also drops an stl
+ * @return How many jobs failed
+ * @remark SDL, the GL context, and the shaders are initialized once here
+ * and shared by every job in the slice; a bad model skips to the next
+ * job instead of killing the run.
  */
-void draw_triangulation(CanimResult* result, GLuint prog, Triangulation* tri)
-{
-    const size_t vertex_size = 28;                     
-    const size_t total_bytes = tri->triangle_count * 3 * vertex_size;
-
-    uint8_t* data = malloc(total_bytes);
-    if (!data) 
-    {
-        *result = DRAW_TRIANGULATION_MALLOC_ERROR;
-        return;
-    }
-
-    uint8_t* p = data;
-    for (int i = 0; i < tri->triangle_count; i++) 
-    {
-        Vec3 a = tri->triangles[i].vertices[0];
-        Vec3 b = tri->triangles[i].vertices[1];
-        Vec3 c = tri->triangles[i].vertices[2];
-        Vec3 n = tri->triangles[i].fd.normal;
-        uint32_t col = tri->triangles[i].fd.color.rgba;
-
-        Vec3 verts[3] = { a, b, c };
-        for (int v = 0; v < 3; v++) 
-        {
-            *(float*)(p + 0)  = verts[v].x;
-            *(float*)(p + 4)  = verts[v].y;
-            *(float*)(p + 8)  = verts[v].z;
-            *(float*)(p + 12) = n.x;
-            *(float*)(p + 16) = n.y;
-            *(float*)(p + 20) = n.z;
-            *(uint32_t*)(p + 24) = col;
-            p += vertex_size;
-        }
-    }
-
-    GLuint vao, vbo;
-    pglGenVertexArrays(1, &vao);
-    pglBindVertexArray(vao);
-
-    pglGenBuffers(1, &vbo);
-    pglBindBuffer(GL_ARRAY_BUFFER, vbo);
-    pglBufferData(GL_ARRAY_BUFFER, total_bytes, data, GL_STATIC_DRAW);
-    free(data);
 
-    GLint posLoc   = pglGetAttribLocation(prog, "position");
-    GLint normLoc  = pglGetAttribLocation(prog, "normal");
-    GLint colorLoc = pglGetAttribLocation(prog, "color");
+static int render_worker(const RenderJob* jobs, int job_count, int worker, int workers, int width, int height, int fps, bool export_stl)
+{
+    CanimResult result = SUCCESS;
+    SDL_Init(SDL_INIT_VIDEO);
 
-    if (posLoc >= 0) 
+    // offline render: the window is just a GL context holder, never shown,
+    // and its size has nothing to do with the render resolution
+    SDL_Window* win = SDL_CreateWindow("Canim",
+        SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
+        640, 480,
+        SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+    SDL_GLContext ctx = SDL_GL_CreateContext(win);
+    SDL_GL_SetSwapInterval(0);
+    load_gl_shader_functions(&result);
+    if (IS_AN_ERROR(result))
     {
-        pglEnableVertexAttribArray(posLoc);
-        pglVertexAttribPointer(posLoc, 3, GL_FLOAT, GL_FALSE, 28, (void*)0);
+        print_error(result);
+        SDL_Quit();
+        return (job_count - worker + workers - 1) / workers;
     }
-    if (normLoc >= 0) 
+    RenderContext rc;
+    render_context_init(&result, &rc, width, height, fps);
+    if (IS_AN_ERROR(result))
     {
-        pglEnableVertexAttribArray(normLoc);
-        pglVertexAttribPointer(normLoc, 3, GL_FLOAT, GL_FALSE, 28, (void*)12);
+        print_error(result);
+        SDL_Quit();
+        return (job_count - worker + workers - 1) / workers;
     }
-    if (colorLoc >= 0) 
+    int failures = 0;
+    for (int i = worker; i < job_count; i += workers)
     {
-        pglEnableVertexAttribArray(colorLoc);
-        pglVertexAttribPointer(colorLoc, 4, GL_UNSIGNED_BYTE, GL_TRUE, 28, (void*)24);
+        CanimResult job_result = SUCCESS;
+        IndexedTriangulation* itri = load_indexed_model(&job_result, jobs[i].input, export_stl);
+        if (!itri)
+        {
+            fprintf(stderr, "%s: ", jobs[i].input);
+            print_error(job_result);
+            failures++;
+            continue;
+        }
+        render_model_video(&job_result, &rc, itri, jobs[i].output);
+        free_indexed_triangulation(itri);
+        if (IS_AN_ERROR(job_result))
+        {
+            fprintf(stderr, "%s: ", jobs[i].input);
+            print_error(job_result);
+            failures++;
+        }
     }
-
-    pglUseProgram(prog);
-    glDrawArrays(GL_TRIANGLES, 0, tri->triangle_count * 3);
-
-    pglBindVertexArray(0);
-    pglDeleteBuffers(1, &vbo);
-    pglDeleteVertexArrays(1, &vao);
+    render_context_destroy(&rc);
+    SDL_GL_DeleteContext(ctx);
+    SDL_DestroyWindow(win);
+    SDL_Quit();
+    return failures;
 }
 
-
-
 /**
  * @brief the main function lol
  * @param argc lol
@@ -3313,120 +8733,162 @@ void draw_triangulation(CanimResult* result, GLuint prog, Triangulation* tri)
  * @return nothinf
  */
 
-int main(int argc, char *argv[]) 
+int main(int argc, char *argv[])
 {
-    if (argc != 2)
+    CANIM_PROF_INSTALL();
+    if (argc < 2)
     {
-        fprintf(stderr, "I wish for two parameters!");
+        fprintf(stderr, "I wish for at least one parameter!");
         return 1;
     }
-
-    CanimResult result = SUCCESS;
-    FILE* fin = fopen(argv[1], "r");
-    Polyhedron* poly = read_off_into_polyhedron(&result, fin);
-    fclose(fin);
-    
-
-    if (IS_AN_ERROR(result))
+    const char* batch_path = null;
+    const char* input = null;
+    int first_flag = 2;
+    if (strcmp(argv[1], "--batch") == 0)
     {
-        print_error(result);
-        return 1;
+        if (argc < 3)
+        {
+            fprintf(stderr, "--batch wishes for a manifest!");
+            return 1;
+        }
+        batch_path = argv[2];
+        first_flag = 3;
     }
-    Triangulation* tri = empty_triangulation(&result);
-    if (IS_AN_ERROR(result))
+    else
     {
-        print_error(result);
-        return 1;
+        input = argv[1];
     }
-
-    triangulate_polyhedron(&result, poly, tri);
-    if (IS_AN_ERROR(result))
+    bool export_stl = false;
+    int width = 800;
+    int height = 600;
+    int fps = 60;
+    int workers = 1;
+    for (int i = first_flag; i < argc; i++)
     {
-        print_error(result);
-        return 1;
+        if (strcmp(argv[i], "--stl") == 0)
+        {
+            export_stl = true;
+        }
+        else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc && sscanf(argv[i + 1], "%dx%d", &width, &height) == 2)
+        {
+            i++;
+        }
+        else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc && sscanf(argv[i + 1], "%d", &fps) == 1)
+        {
+            i++;
+        }
+        else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc && sscanf(argv[i + 1], "%d", &workers) == 1)
+        {
+            i++;
+        }
+        else
+        {
+            fprintf(stderr, "The only flags I know are --stl, --size WxH, --fps N, and --jobs N!");
+            return 1;
+        }
     }
-    FILE* fin2 = fopen("e.stl", "wb");
-    write_to_stl(&result, tri, fin2);
-    if (IS_AN_ERROR(result))
+    if (width < 1 || height < 1 || fps < 1 || workers < 1)
     {
-        print_error(result);
+        fprintf(stderr, "The size, fps, and jobs have to be positive!");
         return 1;
     }
-    fclose(fin2);
-
-    SDL_Init(SDL_INIT_VIDEO);
 
-    SDL_GL_SetAttribute(SDL_GL_MULTISAMPLEBUFFERS, 1);
-    SDL_GL_SetAttribute(SDL_GL_MULTISAMPLESAMPLES, 4);
-
-    SDL_Window* win = SDL_CreateWindow("Canim",
-        SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
-        800, 600,
-        SDL_WINDOW_OPENGL | SDL_WINDOW_SHOWN);
-
-    SDL_GLContext ctx = SDL_GL_CreateContext(win);
-    load_gl_shader_functions(&result);
-    if (IS_AN_ERROR(result)) {
-        print_error(result);
-        return 1;
+    CanimResult result = SUCCESS;
+    RenderJob single = { null, null };
+    RenderJob* jobs = &single;
+    int job_count = 1;
+    if (batch_path)
+    {
+        jobs = read_render_manifest(&result, batch_path, &job_count);
+        if (IS_AN_ERROR(result))
+        {
+            print_error(result);
+            return 1;
+        }
+        if (job_count == 0)
+        {
+            free_render_jobs(jobs, 0);
+            return 0;
+        }
     }
-    GLuint prog = create_shader_program(&result, triangulation_vs, triangulation_fs);
-    if (IS_AN_ERROR(result)) {
-        print_error(result);
-        return 1;
+    else
+    {
+        single.input = (char*)input;
+        single.output = (char*)"out.mp4";
     }
-
-    
-
-    glEnable(GL_MULTISAMPLE);
-    glEnable(GL_DEPTH_TEST);
-    SDL_Event e;
-    float angle = 0;
-    int running = 1;
-    FILE* pipef = open_ffmpeg_pipe(800, 600, 60, "out.mp4");  
-    if (!pipef) 
+    if (workers > job_count)
     {
-        fprintf(stderr, "Failed to open ffmpeg pipe\n");
-        return 1;
+        workers = job_count;
     }
-    for (;running;) 
+
+    int failures = 0;
+#ifndef _WIN32
+    /*
+        Fan out one process per worker before any SDL/GL state exists, so
+        every worker owns a whole GL context (contexts don't cross process
+        lines anyway). A failed fork just means its slice runs in the
+        parent afterwards.
+    */
+    pid_t* kids = workers > 1 ? malloc((workers - 1) * sizeof(pid_t)) : null;
+    int spawned = 0;
+    int* orphan_slices = workers > 1 ? malloc((workers - 1) * sizeof(int)) : null;
+    int orphan_count = 0;
+    if (kids && orphan_slices)
     {
-        for (;SDL_PollEvent(&e);)
+        for (int w = 1; w < workers; w++)
         {
-            if (e.type == SDL_QUIT) 
+            pid_t pid = fork();
+            if (pid == 0)
+            {
+                free(kids);
+                free(orphan_slices);
+                int kid_failures = render_worker(jobs, job_count, w, workers, width, height, fps, export_stl);
+                if (batch_path)
+                {
+                    free_render_jobs(jobs, job_count);
+                }
+                return kid_failures > 0 ? 1 : 0;
+            }
+            if (pid > 0)
+            {
+                kids[spawned++] = pid;
+            }
+            else
             {
-                running = 0;
+                orphan_slices[orphan_count++] = w;
             }
         }
-        glClearColor(0.0f,0.0f,0.0f,1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        glMatrixMode(GL_PROJECTION);
-        glLoadIdentity();
-        float aspect = 800.0f/600.0f;
-        glFrustum(-1*aspect, 1*aspect, -1, 1, 1, 10);
-        glMatrixMode(GL_MODELVIEW);
-        glLoadIdentity();
-        glTranslatef(0,0,-3);
-        angle+=1;
-        glRotatef(angle, 1, 1, 0);   
-        pglUseProgram(prog);                  
-        draw_triangulation(&result, prog, tri);        
-        pglUseProgram(0);                    
-            
-
-        SDL_GL_SwapWindow(win);
-        int w = 800, h = 600;
-        CanimResult frame_result;
-        unsigned char* rgb = get_framebuffer_rgb(&frame_result, w, h, null);
-        if (frame_result == SUCCESS && rgb) 
+    }
+    failures += render_worker(jobs, job_count, 0, workers, width, height, fps, export_stl);
+    for (int i = 0; i < orphan_count; i++)
+    {
+        failures += render_worker(jobs, job_count, orphan_slices[i], workers, width, height, fps, export_stl);
+    }
+    for (int i = 0; i < spawned; i++)
+    {
+        int status = 0;
+        waitpid(kids[i], &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
         {
-            fwrite(rgb, 1, w*h*3, pipef);  
+            failures++;
         }
-        free(rgb);
     }
-    close_ffmpeg_pipe(pipef);
-    SDL_GL_DeleteContext(ctx);
-    SDL_DestroyWindow(win);
-    SDL_Quit();
-    return 0;
+    free(kids);
+    free(orphan_slices);
+#else
+    if (workers > 1)
+    {
+        fprintf(stderr, "--jobs is posix only, rendering serially\n");
+        workers = 1;
+    }
+    failures = render_worker(jobs, job_count, 0, workers, width, height, fps, export_stl);
+#endif
+
+    if (batch_path)
+    {
+        free_render_jobs(jobs, job_count);
+    }
+    return failures > 0 ? 1 : 0;
 }
+
+#endif // CANIM_BENCH_DRIVER